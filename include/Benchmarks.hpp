@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Shader.hpp"
+
+///////////////////////////
+// Benchmarks: opt-in timing runs, toggled by the BENCHMARK_* defines in main.cpp. Results go to stdout.
+///////////////////////////
+
+// per-draw cost of uploading model + normalMat, by uniform name vs by cached handle. Needs a current GL context.
+void benchmark_uniform_upload(Shader& shader);
+
+// closed-form parallel generate_sierpinski vs the recursive generator, degrees 8-14. CPU only.
+void benchmark_sierpinski();
+
+// cone mesh generation throughput per LOD sector count, and the cost of spawning from the cache. CPU only.
+void benchmark_cone_generation();
+
+// BC1/BC3/BC4/BC5 encode throughput and PSNR on the images in res/. CPU only, run from src/ like the program.
+void benchmark_texture_compression();
+
+// clustered light binning time for 10k point lights scattered through the view frustum. CPU only.
+void benchmark_light_binning();
+
+// frustum culling 1M bounding spheres / AABBs: scalar Frustum tests vs the SoA SIMD cull_* batches. CPU only.
+void benchmark_frustum_culling();
+
+// BVH over 1M AABBs: build, refit, hierarchical vs linear SIMD frustum culling and raycasts. CPU only.
+void benchmark_bvh();
+
+// software occlusion culling: a wall of occluder boxes in front of 100k cubes, rasterize + Hi-Z and test times. CPU only.
+void benchmark_occlusion_culling();
+
+// mesh arena sub-allocation: TLSF OffsetAllocator vs a first-fit free list under streaming churn, with the
+// fragmentation each leaves behind. CPU only.
+void benchmark_mesh_allocator();
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Frustum.hpp"
+#include "Culling.hpp"
+
+// 32 bytes, two per cache line. Nodes are stored depth first: an inner node's left child is the node right after it.
+struct BvhNode
+{
+    glm::vec3 min;
+    uint32_t offset;    // leaf: first entry of Bvh::primitives; inner: index of the right child
+    glm::vec3 max;
+    uint32_t count;     // primitives in the leaf, 0 for inner nodes
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes");
+
+struct BvhHit
+{
+    uint32_t object;    // index into the bounds the tree was built from
+    float t;            // distance along the ray, in units of the direction's length
+};
+
+///////////////////////////
+// Bvh: bounding volume hierarchy over the AABBs of a CullBounds set. Built with binned SAH; the top levels are split
+//      serially until there is a subtree per thread or so, the subtrees are then built in parallel. refit() updates
+//      the boxes of moving objects without changing the topology. Queries return the objects' CullBounds indices.
+///////////////////////////
+class Bvh
+{
+public:
+    std::vector<BvhNode> nodes;         // nodes[0] is the root
+    std::vector<uint32_t> primitives;   // object indices, every leaf owns a contiguous range
+
+    void build(const CullBounds& bounds);
+
+    // same objects, new boxes (same order as in build). Tree quality degrades if they move far, rebuild then.
+    void refit(const CullBounds& bounds);
+
+    // hierarchical frustum cull: subtrees fully inside a plane stop testing it, fully inside ones are emitted untested.
+    // Writes the visible object indices (room for the object count) and returns how many.
+    size_t cull(const Frustum& frustum, uint32_t* visible) const;
+
+    // nearest object AABB hit by origin + t * direction with 0 <= t <= max_t
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_t, BvhHit& hit) const;
+
+    size_t depth() const;
+
+private:
+    // per primitive boxes in primitives order, so leaves test contiguous memory
+    std::vector<glm::vec3> leaf_min, leaf_max;
+};
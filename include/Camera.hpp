@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "Frustum.hpp"
 
 enum Camera_Movement    // Used as abstraction to stay away from glfw-specific input methods.
 {
@@ -46,6 +47,9 @@ public:
     // returns the view matrix calculated using Euler angles and the lookAt matrix
     glm::mat4 get_view_matrix() const;
 
+    // world space clip planes of projection * view, for culling against what this camera sees
+    Frustum get_frustum(const glm::mat4& projection) const;
+
     // processes input recieved from keyboard-like input system. Abstracted thru ENUM
     void process_keyboard_input(Camera_Movement direction, float delta_time);
 
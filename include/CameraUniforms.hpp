@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// fixed uniform block binding points, every Shader binds its blocks to these after linking
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+const GLuint CLUSTERS_BLOCK_BINDING = 2;
+
+// CPU mirror of the std140 "Camera" uniform block declared in the shaders
+struct CameraBlock
+{
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPos; // xyz position, w unused (std140 pads vec3 to 16 bytes anyway)
+};
+
+///////////////////////////
+// CameraUniforms: the per-frame camera UBO. Updated once per frame and read by every program through
+//                 the Camera block, instead of each program getting its own view/projection uploads.
+///////////////////////////
+class CameraUniforms
+{
+public:
+    unsigned int ID;
+
+    CameraUniforms();
+
+    void update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position);
+
+    void destroy();
+};
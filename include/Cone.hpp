@@ -4,56 +4,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
-
-// TODO
-// class Cone 
-// {
-// public:
-//     // float radius;
-//     // float height;
-
-//     Cone(float radius, float height, int nSectors, int nStacks, bool smoothness, glm::vec3 upDir)
-//     {
-
-//     }
-
-//     void buildVerticesSmooth()
-//     {
-//         float x, y, z; // vertex positions
-//         float radius;  // radius for each stack 
-
-//         // get normals for the sides
-//         std::vector<float> sideNormals = getSideNormals();
-
-//         for(int i=0; i <= stackCount; i++)
-//         {
-
-//         }
-//     }
-
-// private:
-//     void buildUnityCircleVertices()
-//     {
-
-//     }
-
-//     std::vector<float> getSideNormals()
-//     {
-
-//     }
-
-//     void addVertex(float x, float y, float z)
-//     {
-
-//     }
-
-//     void addNormal(float nx, float ny, float nz)
-//     {
-
-//     }
-
-//     void addIndices(unsigned int i1, unsigned int i2, unsigned int i3)
-//     {
-
-//     }
-// };
\ No newline at end of file
+#include <map>
+#include "Mesh.hpp"
+
+///////////////////////////
+// Cone: unit cone with base radius 1 at y = -0.5 and its apex at y = 0.5. Radius, height and direction come
+//       from the model matrix (see get_model_matrix), so one mesh per (sectors, stacks) serves every cone size.
+//       The normal matrix keeps the analytic side normals correct under the non-uniform scale.
+///////////////////////////
+class Cone 
+{
+public:
+    static const int MIN_SECTORS = 4;
+
+    // cached smooth shaded cone, generated on first request
+    static const MeshData& get(int nSectors, int nStacks = 1);
+
+    // LOD chain starting at nSectors, halving the sector count per level down to MIN_SECTORS
+    static std::vector<const MeshData*> get_lod_chain(int nSectors, int nStacks, int nLevels);
+
+    // uncached generation, used by get() and the generation benchmark
+    static MeshData build_vertices_smooth(int nSectors, int nStacks);
+
+    // places the unit cone: base centered at position, pointing along upDir
+    static glm::mat4 get_model_matrix(glm::vec3 position, float radius, float height, glm::vec3 upDir = glm::vec3(0.0f, 1.0f, 0.0f));
+
+private:
+    // (cos, -sin) of every sector angle, shared by every cone with the same sector count
+    static const std::vector<glm::vec2>& get_unit_circle_vertices(int nSectors);
+};
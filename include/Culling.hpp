@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Frustum.hpp"
+
+///////////////////////////
+// CullBounds: world space bounds of many objects in SoA layout, so the cull_* functions test 4 (SSE) or 8 (AVX)
+//             objects per instruction. Every object has both a bounding sphere and an AABB around the same center.
+///////////////////////////
+struct CullBounds
+{
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> extent_x, extent_y, extent_z; // AABB half extents
+    std::vector<float> radius;                       // bounding sphere
+
+    size_t size() const { return center_x.size(); }
+    void clear();
+    void reserve(size_t count);
+
+    void add_sphere(const glm::vec3& center, float radius);
+    void add_aabb(const glm::vec3& min, const glm::vec3& max);
+    // world AABB of a local box under an affine transform (rotations grow it to the box's rotated extents)
+    void add_transformed_aabb(const glm::vec3& local_min, const glm::vec3& local_max, const glm::mat4& model);
+};
+
+// write the indices of the objects that intersect the frustum to visible (room for bounds.size()), return how many.
+// Conservative: near a frustum corner an object may be kept although it is just outside.
+size_t cull_spheres(const Frustum& frustum, const CullBounds& bounds, uint32_t* visible);
+size_t cull_aabbs(const Frustum& frustum, const CullBounds& bounds, uint32_t* visible);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+///////////////////////////
+// FrameTimer: averages frame times and prints them once per reporting interval, tagged with the current render mode.
+///////////////////////////
+class FrameTimer
+{
+public:
+    float report_interval;
+
+    FrameTimer(float report_interval = 1.0f)
+        : report_interval(report_interval), elapsed(0.0f), frames(0) {}
+
+    // returns true on the frames a report was printed
+    bool tick(float delta_time, const std::string& mode)
+    {
+        if(mode != current_mode) // restart the average so modes are never mixed
+        {
+            current_mode = mode;
+            elapsed = 0.0f;
+            frames = 0;
+            return false;
+        }
+        elapsed += delta_time;
+        frames++;
+        if(elapsed >= report_interval)
+        {
+            std::cout << "FRAME::" << current_mode << "::" << 1000.0f * elapsed / frames << " ms ("
+                      << frames / elapsed << " fps)" << std::endl;
+            elapsed = 0.0f;
+            frames = 0;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::string current_mode;
+    float elapsed;
+    int frames;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+///////////////////////////
+// Frustum: the six clip planes of a projection * view matrix, normalized and pointing inwards
+//          (a point is inside when dot(plane.xyz, p) + plane.w >= 0 for all six).
+///////////////////////////
+struct Frustum
+{
+    enum { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR }; // not NEAR / FAR, windows.h defines those
+    glm::vec4 planes[6];
+
+    static Frustum from_matrix(const glm::mat4& projection_view);
+
+    bool intersects_sphere(const glm::vec3& center, float radius) const;
+    // AABB given by center and half extents
+    bool intersects_aabb(const glm::vec3& center, const glm::vec3& extent) const;
+};
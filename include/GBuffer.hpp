@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "Shader.hpp"
+
+// the G-buffer textures take this unit and the three after it in the lighting pass (albedo, specular, normal, depth)
+const GLuint GBUFFER_TEXTURE_UNIT = 0;
+
+///////////////////////////
+// GBuffer: render targets of the deferred path. The geometry pass (color_cube.frag with GBUFFER_PASS) writes
+//          albedo, specular + shininess and world normals, plus depth; light() then shades every covered pixel once
+//          with a full-screen triangle (color_cube.frag with DEFERRED_LIGHTING) and copies the depth to the default
+//          framebuffer, so forward passes drawn afterwards still depth test against the scene.
+///////////////////////////
+class GBuffer
+{
+public:
+    unsigned int ID;
+    unsigned int albedo;    // RGBA8
+    unsigned int specular;  // RGBA8, a = shininess / 256
+    unsigned int normal;    // RGBA16F
+    unsigned int depth;     // DEPTH24_STENCIL8, same as the default framebuffer so it can be blitted
+    int width;
+    int height;
+
+    GBuffer(int width, int height);
+
+    // reallocates the targets when the framebuffer size changed
+    void resize(int width, int height);
+
+    // binds and clears the G-buffer for the geometry pass
+    void begin_geometry();
+
+    // back to the default framebuffer: shades with lighting_shader (samplers gAlbedo.. set to GBUFFER_TEXTURE_UNIT + 0..3),
+    // then copies depth over
+    void light(Shader& lighting_shader);
+
+    void destroy();
+
+private:
+    unsigned int fullscreen_vao; // empty, core profile needs one bound to draw
+
+    void allocate();
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+///////////////////////////
+// GLStateCache: shadows the program, VAO, texture unit/binding and polygon mode state so redundant
+//               binds never reach the driver. Every bind in the renderer has to go through it,
+//               otherwise the shadow copy goes stale (call invalidate() after foreign GL code).
+///////////////////////////
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    // binds issued to / dropped before the driver during the last finished frame
+    unsigned int issued_last_frame;
+    unsigned int dropped_last_frame;
+
+    GLStateCache();
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vao);
+    void active_texture(GLenum unit);                   // GL_TEXTURE0 + n
+    void bind_texture(GLenum target, GLuint texture);   // on the active unit
+    void bind_texture_unit(GLuint unit, GLenum target, GLuint texture); // switches the active unit only if needed
+    void polygon_mode(GLenum mode);                     // for GL_FRONT_AND_BACK
+
+    // deleted objects must be forgotten, GL hands out their names again
+    void forget_program(GLuint program);
+    void forget_vertex_array(GLuint vao);
+    void forget_texture(GLuint texture);
+
+    // drop everything we know, the next bind of each kind is always issued
+    void invalidate();
+
+    // rolls this frame's counters into the *_last_frame fields
+    void begin_frame();
+
+private:
+    enum TargetSlot { SLOT_2D, SLOT_2D_ARRAY, SLOT_CUBE_MAP, SLOT_3D, SLOT_BUFFER, N_TARGET_SLOTS };
+    static const GLuint UNKNOWN = ~0u;
+
+    GLuint program;
+    GLuint vao;
+    GLenum active_unit;
+    GLuint textures[MAX_TEXTURE_UNITS][N_TARGET_SLOTS];
+    GLenum polygon;
+
+    unsigned int issued;
+    unsigned int dropped;
+
+    static int target_slot(GLenum target);
+    bool changed(GLuint& current, GLuint wanted);
+};
+
+// the renderer's single state cache (one GL context)
+GLStateCache& gl_state();
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "InstanceBuffer.hpp"
+#include "MeshArena.hpp"
+
+// one draw as glMultiDrawElementsIndirect reads it from GL_DRAW_INDIRECT_BUFFER (the layout is fixed by GL)
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+// glad only loads GL 3.3, so glMultiDrawElementsIndirect (GL 4.3 or ARB_multi_draw_indirect + ARB_base_instance)
+// is fetched by hand. Call once after gladLoadGLLoader, returns whether the context has it.
+bool load_multi_draw_indirect(GLADloadproc load);
+bool multi_draw_indirect_supported();
+
+///////////////////////////
+// IndirectBatch: a frame's draws of FORMAT_LIT meshes in one MeshArena, packed into a command buffer on the CPU. Every
+//                command's instances are appended to a shared InstanceBuffer (attached to the arena VAO at
+//                location 3) and the command points at them through base_instance, so draw() is a single
+//                glMultiDrawElementsIndirect. Without MDI it loops glDrawElementsInstancedBaseVertex over the
+//                same commands, re-pointing the instance attributes at each command's first instance.
+///////////////////////////
+class IndirectBatch
+{
+public:
+    unsigned int ID; // GL_DRAW_INDIRECT_BUFFER
+    bool use_multi_draw; // false forces the per-draw fallback even when MDI is supported
+
+    // GL draw calls issued by the last draw()
+    unsigned int draw_calls;
+
+    IndirectBatch(const MeshArena& arena);
+
+    void clear();
+
+    // draws mesh once per instance. Successive adds of the same mesh are merged into one command.
+    void add(const MeshRange& mesh, const InstanceData* instances, size_t count);
+    void add(const MeshRange& mesh, const InstanceData& instance) { add(mesh, &instance, 1); }
+
+    // uploads the commands and instances, once per frame after the last add()
+    void upload();
+
+    // issues every command, the arena VAO and a program with the instanced path must be usable
+    void draw(GLenum mode = GL_TRIANGLES);
+
+    size_t size() const { return commands.size(); }
+    size_t instance_count() const { return instance_data.size(); }
+
+    void destroy();
+
+private:
+    unsigned int vao;
+    InstanceBuffer instances;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<InstanceData> instance_data;
+    size_t capacity; // commands ID has room for
+};
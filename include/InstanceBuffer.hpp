@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// per-instance data read by the instanced vertex shaders (attribute locations 3-11)
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat4 normalMat;
+    uint32_t layer = 0; // material layer in the MaterialLibrary texture arrays
+};
+
+///////////////////////////
+// InstanceBuffer: VBO of InstanceData fed to the vertex shader with a divisor of 1,
+//                 so N objects sharing a mesh cost one glDraw*Instanced call.
+///////////////////////////
+class InstanceBuffer
+{
+public:
+    unsigned int ID;
+
+    InstanceBuffer();
+
+    // wires model (first_location .. +3), normalMat (first_location+4 .. +7) and layer (first_location+8) into the given VAO.
+    // Instance 0 of a draw reads first_instance, the GL 3.3 stand-in for a base instance.
+    void attach(unsigned int vao, unsigned int first_location, size_t first_instance = 0) const;
+
+    // replaces the contents. Grows geometrically, otherwise orphans the old storage so the upload never waits on the GPU.
+    void upload(const InstanceData* instances, size_t count);
+
+    size_t size() const { return count; }
+
+    void destroy();
+
+private:
+    size_t capacity;
+    size_t count;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "Lights.hpp"
+
+// cluster grid: 16 x 9 screen tiles, 24 exponential depth slices between near and far
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// the three buffer textures take this unit and the two after it
+const GLuint CLUSTER_TEXTURE_UNIT = 4;
+
+// CPU mirror of the std140 "Clusters" uniform block
+struct ClustersBlock
+{
+    glm::uvec4 grid;  // x, y, z, number of directional lights (they come first and apply everywhere)
+    glm::vec4 depth;  // slice = log(view depth) * x + y, zw = 1 / viewport size
+};
+
+///////////////////////////
+// ClusterGrid: CPU half of clustered forward shading. Splits the view frustum into CLUSTER_X * CLUSTER_Y * CLUSTER_Z
+//              view space AABBs and bins every other point / spot light than the global ones (is_global_light)
+//              into the clusters its range sphere touches.
+//              Slices are binned in parallel, each cluster row is tested four AABBs at a time with SSE.
+//              No GL, so it can be benchmarked on its own.
+///////////////////////////
+class ClusterGrid
+{
+public:
+    std::vector<GpuLight> lights;       // global lights first (is_global_light), then every point / spot light inside the frustum depth range
+    size_t global_count;
+    std::vector<glm::uvec2> clusters;   // per cluster (x fastest, then y, then z): first index, index count
+    std::vector<uint32_t> indices;      // into lights
+    size_t max_indices;                 // indices past this are dropped, GL_MAX_TEXTURE_BUFFER_SIZE on the GPU side
+    size_t dropped;                     // last bin()
+
+    ClusterGrid();
+
+    // same arguments as the glm::perspective call, rebuilds the cluster AABBs only when they changed
+    void set_projection(float fov_y_degrees, float aspect, float z_near, float z_far);
+
+    void bin(const Light* scene_lights, size_t count, const glm::mat4& view);
+
+    float slice_scale() const { return scale; }
+    float slice_bias() const { return bias; }
+
+private:
+    float fov_y, aspect, z_near, z_far;
+    float scale, bias;
+    // cluster AABBs in view space with z as positive depth, SoA so a row of four is one SSE load
+    std::vector<float> min_x, min_y, min_z, max_x, max_y, max_z;
+    // per slice and row: y extent of the whole row, for an early out
+    std::vector<float> row_min_y, row_max_y;
+
+    // view space light spheres that survived the depth test
+    std::vector<float> center_x, center_y, center_z, radius;
+    std::vector<int> first_slice, last_slice;
+    std::vector<std::vector<uint32_t>> slice_indices;
+    std::vector<std::vector<uint32_t>> slice_pairs;
+};
+
+///////////////////////////
+// LightClusters: GPU half. Uploads ClusterGrid's lights, cluster ranges and index list into buffer textures every
+//                frame (GL 3.3 has no SSBOs) and the grid parameters into the Clusters block. color_cube.frag
+//                compiled with shader_defines() then shades only the lights of its own cluster.
+///////////////////////////
+class LightClusters
+{
+public:
+    unsigned int ID; // Clusters block UBO
+    ClusterGrid grid;
+
+    LightClusters();
+
+    // "#define CLUSTERED_LIGHTS\n"; the program also needs its clusterLights / clusterRanges / clusterIndices samplers
+    // set to CLUSTER_TEXTURE_UNIT + 0 / 1 / 2
+    std::string shader_defines() const;
+
+    void update(const Light* lights, size_t count, const glm::mat4& view, int viewport_width, int viewport_height);
+
+    // binds the three buffer textures, before drawing with a clustered program
+    void bind() const;
+
+    void destroy();
+
+private:
+    // lights (RGBA32F, 6 texels each), cluster ranges (RG32UI), indices (R32UI)
+    unsigned int buffers[3];
+    unsigned int textures[3];
+};
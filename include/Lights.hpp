@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <string>
+#include "Frustum.hpp"
+
+enum LightType
+{
+    LIGHT_DIRECTIONAL = 0,
+    LIGHT_POINT = 1,
+    LIGHT_SPOT = 2
+};
+
+// a light as the scene describes it
+struct Light
+{
+    LightType type = LIGHT_POINT;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 ambient = glm::vec3(0.0f);    // unattenuated and not limited by range, see is_global_light()
+    glm::vec3 diffuse = glm::vec3(1.0f);
+    glm::vec3 specular = glm::vec3(1.0f);
+    float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+    float range = 50.0f;          // no contribution past this distance, also the culling radius
+    float inner_cutoff = 1.0f;    // spot: cosines of the full intensity and the falloff edge angles
+    float outer_cutoff = 1.0f;
+};
+
+// directional lights and lights with an ambient term (the flashlight) reach every fragment, so they are never culled
+bool is_global_light(const Light& light);
+
+// point light whose attenuation reaches about 1/256 at range, no ambient
+Light make_point_light(const glm::vec3& position, const glm::vec3& color, float range);
+Light make_spot_light(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float range, float inner_degrees, float outer_degrees);
+Light make_directional_light(const glm::vec3& direction, const glm::vec3& color);
+
+// CPU mirror of one std140 Light in the "Lights" block, 96 bytes
+struct GpuLight
+{
+    glm::vec4 position;    // xyz, w = type
+    glm::vec4 direction;   // xyz, w = range
+    glm::vec4 ambient;     // rgb, w unused
+    glm::vec4 diffuse;     // rgb, w = cos inner cutoff
+    glm::vec4 specular;    // rgb, w = cos outer cutoff
+    glm::vec4 attenuation; // constant, linear, quadratic, unused
+};
+
+GpuLight pack_light(const Light& light);
+
+///////////////////////////
+// LightUniforms: the per-frame light UBO. update() culls the scene's lights against the view frustum, packs the
+//                survivors into std140 GpuLights (nearest first if there are more than fit) and uploads them in one
+//                go; color_cube.frag loops over them. Capacity comes from GL_MAX_UNIFORM_BLOCK_SIZE and reaches the
+//                shader as MAX_LIGHTS through shader_defines().
+///////////////////////////
+class LightUniforms
+{
+public:
+    unsigned int ID;
+    // last update()
+    size_t visible;
+    size_t culled;
+    size_t dropped; // visible but over capacity
+
+    // max_lights is clamped to what one uniform block can hold on this device
+    explicit LightUniforms(size_t max_lights = 1024);
+
+    size_t capacity() const { return max_lights; }
+
+    // "#define MAX_LIGHTS n\n", pass to the Shader constructor of every program that declares the Lights block
+    std::string shader_defines() const;
+
+    void update(const Light* lights, size_t count, const Frustum& frustum, const glm::vec3& view_position);
+
+    void destroy();
+
+private:
+    size_t max_lights;
+    std::vector<GpuLight> packed;
+    std::vector<const Light*> survivors;
+};
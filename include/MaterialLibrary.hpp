@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+///////////////////////////
+// TextureArray: GL_TEXTURE_2D_ARRAY of same sized RGBA8 layers, each with its full mip chain. Shaders pick the layer
+//               per instance, so draws using different layers need no rebinding.
+///////////////////////////
+class TextureArray
+{
+public:
+    unsigned int ID;
+
+    // srgb: the layers are colors, mips are filtered in linear light. false for data such as specular maps.
+    TextureArray(int width, int height, int max_layers, bool srgb = true);
+
+    // images of another size are resampled to the array size. Returns the layer, or -1 when the array is full.
+    int add_layer(const unsigned char* pixels, int width, int height, int channels);
+
+    int layer_count() const { return count; }
+
+    void destroy();
+
+private:
+    int width;
+    int height;
+    int levels;
+    int capacity;
+    bool srgb;
+    int count;
+};
+
+///////////////////////////
+// MaterialLibrary: the diffuse and specular maps of every material packed into two texture arrays at the same
+//                  layer. A material is its layer index: instances carry it in InstanceData::layer, single draws
+//                  in the "layer" uniform, and the MATERIAL_ARRAY variant of color_cube.frag samples both arrays.
+///////////////////////////
+class MaterialLibrary
+{
+public:
+    TextureArray diffuse;
+    TextureArray specular;
+
+    MaterialLibrary(int size = 512, int max_materials = 16);
+
+    // decodes both maps now. A material without a specular map gets a flat one of default_specular.
+    // Returns the material's layer, -1 if the diffuse map can't be loaded or the library is full.
+    int add(const std::string& diffuse_path, const std::string& specular_path = "", float default_specular = 0.2f);
+
+    int size() const { return diffuse.layer_count(); }
+
+    void destroy();
+};
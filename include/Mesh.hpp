@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// interleaved vertex layout shared by every lit mesh (matches the cube: pos, normal, tex coords)
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 tex_coords;
+};
+
+// CPU side indexed triangle list
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    // indices fit in GL_UNSIGNED_SHORT
+    bool uses_16bit_indices() const { return vertices.size() <= 0xFFFF + 1; }
+};
+
+// average cache miss ratio: post-transform cache misses per triangle, simulated with a FIFO cache.
+// 3.0 is the worst case, ~0.5-0.7 is good for a regular grid.
+float compute_acmr(const std::vector<uint32_t>& indices, size_t n_vertices, int cache_size = 16);
+
+// reorders triangles for the post-transform vertex cache (Forsyth's linear-speed optimizer)
+void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t n_vertices);
+
+// renumbers vertices in first-use order so vertex fetch walks the buffer linearly
+void optimize_vertex_fetch(MeshData& mesh);
+
+// LOD level for an object with the given bounding radius at distance: one level coarser every time its
+// projected height halves below fullDetailPixels. Clamped to [0, nLevels).
+int select_lod(float radius, float distance, float fovY, float screenHeight, int nLevels, float fullDetailPixels = 512.0f);
+
+///////////////////////////
+// MeshBuilder: collects triangles from any source, welds bit-identical vertices through a hash table
+//              and hands back an indexed, cache-optimized MeshData.
+///////////////////////////
+class MeshBuilder
+{
+public:
+    // ACMR of the welded mesh in submission order and after optimization, filled in by build()
+    float acmr_before;
+    float acmr_after;
+
+    MeshBuilder();
+
+    void reserve(size_t n_vertices, size_t n_indices);
+
+    // welds v against previously added vertices and returns its index
+    uint32_t add_vertex(const Vertex& v);
+
+    void add_triangle(uint32_t i0, uint32_t i1, uint32_t i2);
+
+    // non-indexed triangle soup, interleaved pos3/normal3/uv2 floats
+    void add_triangles(const float* interleaved, size_t n_vertices);
+
+    // already indexed geometry (e.g. from a generator). Vertices are still welded.
+    void add_indexed(const MeshData& mesh);
+
+    size_t vertex_count() const { return mesh.vertices.size(); }
+
+    MeshData build(bool optimize = true);
+
+private:
+    struct VertexHash
+    {
+        size_t operator()(const Vertex& v) const;
+    };
+    struct VertexEqual
+    {
+        bool operator()(const Vertex& a, const Vertex& b) const;
+    };
+
+    MeshData mesh;
+    std::vector<uint32_t> weld_table; // open addressing over mesh.vertices, ~0u marks an empty slot
+
+    void grow_weld_table();
+};
+
+///////////////////////////
+// Mesh: GPU copy of a MeshData. Picks 16 or 32 bit indices by vertex count.
+///////////////////////////
+class Mesh
+{
+public:
+    unsigned int VAO, VBO, EBO;
+    GLenum index_type;
+    GLsizei index_count;
+    GLsizei vertex_count;
+
+    Mesh(const MeshData& data);
+
+    void draw(GLenum mode = GL_TRIANGLES) const;
+    void draw_instanced(GLsizei instance_count, GLenum mode = GL_TRIANGLES) const;
+
+    void destroy();
+};
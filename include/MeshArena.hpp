@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstddef>
+#include "Mesh.hpp"
+#include "OffsetAllocator.hpp"
+
+// vertex layouts the arena keeps a buffer and VAO for
+enum VertexFormat : uint8_t
+{
+    FORMAT_LIT = 0,         // Vertex: pos, normal, tex coords (locations 0-2)
+    FORMAT_POSITION = 1,    // vec3 pos (location 0), debug lines
+    FORMAT_COLORED = 2,     // vec3 pos, vec3 color (locations 0-1), sierpinski
+    N_VERTEX_FORMATS
+};
+
+size_t vertex_stride(VertexFormat format);
+
+// where a mesh lives in a MeshArena: its indices are relative to base_vertex. index_count 0 is a
+// non-indexed mesh, drawn with glDrawArrays starting at base_vertex.
+struct MeshRange
+{
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    int32_t base_vertex = 0;
+    uint32_t vertex_count = 0;
+    VertexFormat format = FORMAT_LIT;
+    OffsetAllocator::Allocation vertex_block, index_block; // handed back by MeshArena::free()
+};
+
+///////////////////////////
+// MeshArena: one large vertex buffer and VAO per VertexFormat plus one index buffer shared by all of them, carved
+//            up by OffsetAllocators. Every mesh of a format draws from the same VAO with base vertex offsets
+//            (or one indirect command), so switching meshes is just a different offset. Indices are always
+//            32 bit. Meshes can be freed and their space reused; a full buffer grows in place, so the buffer
+//            names (and any VAO pointing at them) stay valid.
+///////////////////////////
+class MeshArena
+{
+public:
+    unsigned int EBO;
+    static const GLenum index_type = GL_UNSIGNED_INT;
+
+    // capacities per vertex buffer and for the index buffer
+    MeshArena(size_t vertex_capacity = 1 << 16, size_t index_capacity = 1 << 18);
+
+    // copies vertex_count vertices of format (vertex_stride(format) bytes each) and their indices into the arena
+    MeshRange add(VertexFormat format, const void* vertices, size_t vertex_count, const uint32_t* indices = nullptr, size_t index_count = 0);
+    MeshRange add(const MeshData& mesh);
+
+    // returns the range's space to the allocators and resets it
+    void free(MeshRange& range);
+
+    unsigned int vao(VertexFormat format) const { return buffers[format].VAO; }
+    unsigned int vbo(VertexFormat format) const { return buffers[format].VBO; }
+
+    OffsetAllocator::Stats vertex_stats(VertexFormat format) const { return buffers[format].allocator.stats(); }
+    OffsetAllocator::Stats index_stats() const { return indices.stats(); }
+
+    // usage and fragmentation of every buffer
+    void print_report() const;
+
+    void destroy();
+
+private:
+    struct FormatBuffer
+    {
+        unsigned int VAO, VBO;
+        OffsetAllocator allocator; // in vertices
+    };
+
+    FormatBuffer buffers[N_VERTEX_FORMATS];
+    OffsetAllocator indices;
+
+    // allocates count units, growing buffer (element_size bytes per unit) when no free block is large enough
+    static OffsetAllocator::Allocation allocate(OffsetAllocator& allocator, unsigned int buffer, size_t element_size, uint32_t count);
+
+    // reallocates buffer with room for new_size bytes, keeping the first used bytes
+    static void grow(unsigned int buffer, size_t used, size_t new_size);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+enum MipFilter
+{
+    MIP_FILTER_BOX,     // 2x2 average, what glGenerateMipmap does on most drivers
+    MIP_FILTER_KAISER,  // Kaiser windowed sinc, sharp with little ringing, the default
+    MIP_FILTER_LANCZOS  // Lanczos-3, sharpest, rings the most
+};
+
+struct MipOptions
+{
+    MipFilter filter = MIP_FILTER_KAISER;
+    bool srgb = true;          // color channels are sRGB encoded: filter in linear space, re-encode after
+    float alpha_cutoff = 0.0f; // > 0: alpha tested texture, scale each level's alpha so the fraction of texels
+                               // passing the test stays what it is at level 0 (foliage doesn't thin out with distance)
+    int max_levels = 16;       // including the base level
+};
+
+struct MipLevel
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels; // width * height * channels, same channel count as the source
+};
+
+///////////////////////////
+// Mip generation: builds the chain below a base image on the CPU, so it can run on a worker or in the cooker
+//                 and be cached, compressed or streamed instead of calling glGenerateMipmap on the GL thread.
+//                 Pixels are widened to linear float4 and each level is filtered separably from the one above,
+//                 one SSE register per pixel (AVX for two in the vertical pass), rows split across threads.
+///////////////////////////
+
+// levels 1..n (the base is not repeated), each half the size of the last, down to 1x1 or max_levels
+std::vector<MipLevel> generate_mips(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options = MipOptions());
+
+const char* mip_filter_name(MipFilter filter);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.hpp"
+#include "Culling.hpp"
+
+///////////////////////////
+// OcclusionCuller: software hierarchical-Z occlusion culling, entirely on the CPU.
+//                  add_occluder() transforms, near clips, back-face culls and bins an occluder's triangles into
+//                  screen tiles; rasterize() fills a low resolution depth buffer four pixels at a time with SSE
+//                  half-space tests, one tile per job, and builds a max-depth pyramid over it. is_visible() / cull()
+//                  then compare an AABB's nearest depth with the farthest occluder depth under its screen rectangle.
+//                  Per frame: begin(), add_occluder() * n, rasterize(), cull().
+///////////////////////////
+class OcclusionCuller
+{
+public:
+    static const int TILE_WIDTH = 32;
+    static const int TILE_HEIGHT = 16;
+
+    // last frame
+    size_t occluder_triangles; // after clipping and back-face culling
+    size_t tested;
+    size_t occluded;
+
+    // width must be a multiple of TILE_WIDTH, height of TILE_HEIGHT
+    OcclusionCuller(int width = 256, int height = 128);
+
+    void begin(const glm::mat4& projection_view);
+
+    // closed, counter-clockwise meshes only: back faces are skipped
+    void add_occluder(const MeshData& mesh, const glm::mat4& model);
+
+    void rasterize();
+
+    // conservative: boxes crossing the near plane or off screen are visible
+    bool is_visible(const glm::vec3& min, const glm::vec3& max) const;
+
+    // keeps the candidates (indices into bounds) whose AABB is not hidden, visible may be candidates itself
+    size_t cull(const CullBounds& bounds, const uint32_t* candidates, size_t count, uint32_t* visible);
+
+    int width() const { return size_x; }
+    int height() const { return size_y; }
+    // row major, bottom row first, 0 = near plane, 1 = far / nothing drawn
+    const std::vector<float>& depth() const { return hiz[0]; }
+
+private:
+    struct RasterTriangle
+    {
+        float edge_a[3], edge_b[3], edge_c[3]; // e(x, y) = a x + b y + c, >= 0 inside for every edge
+        float depth_a, depth_b, depth_c;       // depth plane over the screen
+        int min_x, min_y, max_x, max_y;        // pixel bounds, inclusive
+    };
+
+    int size_x, size_y;
+    int tiles_x, tiles_y;
+    glm::mat4 projection_view;
+    std::vector<RasterTriangle> triangles;
+    std::vector<std::vector<uint32_t>> tile_bins;
+    std::vector<std::vector<float>> hiz;         // level 0 is the depth buffer, each level halves it taking the max
+    std::vector<glm::ivec2> hiz_size;
+
+    void setup_triangle(const glm::vec4 clip[3]);
+    void rasterize_tile(int tile);
+    void build_hiz();
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+///////////////////////////
+// OffsetAllocator: two-level segregated fit (TLSF) sub-allocator over the range [0, size) of some buffer, in
+//                  whatever unit the caller counts (vertices, indices). Free blocks sit in 32 x 8 size classes
+//                  found through two bitmaps, so allocate() and free() are O(1); freed blocks merge with free
+//                  neighbours immediately. Owns no GPU memory, only hands out offsets.
+///////////////////////////
+class OffsetAllocator
+{
+public:
+    static const uint32_t NO_SPACE = ~0u;
+
+    struct Allocation
+    {
+        uint32_t offset = NO_SPACE;
+        uint32_t node = NO_SPACE;
+        bool valid() const { return offset != NO_SPACE; }
+    };
+
+    struct Stats
+    {
+        uint32_t size;
+        uint32_t free;
+        uint32_t largest_free;
+        uint32_t free_blocks;
+        uint32_t allocations;
+
+        // 1 - largest free block / free space: 0 while all free space is one block
+        float fragmentation() const { return free ? 1.0f - (float)largest_free / free : 0.0f; }
+    };
+
+    OffsetAllocator(uint32_t size = 0);
+
+    // an invalid Allocation when no free block is large enough
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+
+    // extends the range to new_size, the new space merges with a free block at the old end
+    void grow(uint32_t new_size);
+
+    uint32_t size() const { return total; }
+    Stats stats() const;
+
+private:
+    static const int SL_BITS = 3;
+    static const int SL_COUNT = 1 << SL_BITS;
+    static const int FL_COUNT = 32;
+
+    struct Node
+    {
+        uint32_t offset, size;
+        uint32_t prev_free, next_free;          // size class list, while free
+        uint32_t prev_neighbor, next_neighbor;  // address order
+        bool used;
+    };
+
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    uint32_t heads[FL_COUNT][SL_COUNT];
+    std::vector<Node> nodes;
+    std::vector<uint32_t> spare_nodes; // recycled node slots
+    uint32_t total, free_space, allocations;
+    uint32_t last; // node at the end of the range
+
+    // size class of a block of size (rounds down, for inserting)
+    static void mapping(uint32_t size, int& fl, int& sl);
+
+    uint32_t new_node(uint32_t offset, uint32_t size);
+    void insert_free(uint32_t node);
+    void remove_free(uint32_t node);
+};
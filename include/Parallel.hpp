@@ -0,0 +1,43 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// number of threads worth spawning for data-parallel loops
+inline unsigned int worker_count()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// splits [begin, end) into one contiguous chunk per hardware thread and calls fn(chunk_begin, chunk_end) on each.
+// The calling thread takes the last chunk. Chunks never get smaller than min_chunk.
+template<typename Fn>
+void parallel_for(size_t begin, size_t end, Fn&& fn, size_t min_chunk = 1)
+{
+    if(end <= begin)
+        return;
+    size_t count = end - begin;
+    size_t n_chunks = std::min<size_t>(worker_count(), (count + min_chunk - 1) / min_chunk);
+    if(n_chunks <= 1)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    size_t chunk = (count + n_chunks - 1) / n_chunks;
+    std::vector<std::thread> threads;
+    threads.reserve(n_chunks - 1);
+    for(size_t c = 0; c + 1 < n_chunks; c++)
+    {
+        size_t chunk_begin = begin + c * chunk;
+        size_t chunk_end = std::min(end, chunk_begin + chunk);
+        threads.emplace_back([&fn, chunk_begin, chunk_end]() { fn(chunk_begin, chunk_end); });
+    }
+    fn(std::min(end, begin + (n_chunks - 1) * chunk), end);
+
+    for(std::thread& thread : threads)
+        thread.join();
+}
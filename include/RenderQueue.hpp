@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Shader.hpp"
+#include "Mesh.hpp"
+#include "MeshArena.hpp"
+#include "IndirectBatch.hpp"
+
+// passes draw in this order, everything in a pass is sorted by state
+enum RenderPass : uint8_t
+{
+    PASS_OPAQUE = 0,
+    PASS_DEBUG_LINES = 1,
+};
+
+// one draw submission. Per-frame uniforms (view, projection, lights) are set on the program before flush().
+struct DrawCommand
+{
+    Shader* shader = nullptr;
+    GLuint vao = 0;
+    GLuint textures[2] = { 0, 0 };  // bound to units 0 and 1 (diffuse, specular), 0 leaves the unit alone
+    GLenum texture_target = GL_TEXTURE_2D; // GL_TEXTURE_2D_ARRAY for MaterialLibrary arrays
+    int layer = 0;                  // material layer of a single draw, instances carry their own
+    uint16_t material = 0;          // sort id of the texture set, equal ids must mean equal textures
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;              // vertices, or indices when index_type is set
+    GLenum index_type = 0;          // 0 draws with glDrawArrays
+    GLuint first_index = 0;         // offsets into a shared index / vertex buffer (MeshArena)
+    GLint base_vertex = 0;          // also the first vertex of a glDrawArrays
+    IndirectBatch* batch = nullptr; // draws the whole batch through the instanced path instead of the fields above
+    GLsizei instance_count = 0;     // 0 is a single draw using model/normalMat below
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat4 normalMat = glm::mat4(1.0f);
+};
+
+// indexed draw of a whole mesh
+DrawCommand mesh_draw_command(Shader& shader, const Mesh& mesh);
+DrawCommand mesh_draw_command(Shader& shader, const MeshArena& arena, const MeshRange& mesh);
+
+// every command of an IndirectBatch over the arena's FORMAT_LIT meshes as one queued draw
+DrawCommand batch_draw_command(Shader& shader, const MeshArena& arena, IndirectBatch& batch);
+
+// 64 bit key, most significant first:  pass (4) | program (12) | material (16) | vao (12) | depth (20)
+// depth01 is the normalized view distance, so equal state sorts front to back.
+uint64_t make_sort_key(RenderPass pass, GLuint program, uint16_t material, GLuint vao, float depth01);
+
+///////////////////////////
+// RenderQueue: collects a frame's draws, radix sorts them by key and issues them through the GL state cache,
+//              so every pass runs in state order and each program/VAO/texture change happens once.
+///////////////////////////
+class RenderQueue
+{
+public:
+    // program changes and draws issued by every flush since the last clear(), so a frame split across
+    // flush_through() / flush() counts as one
+    unsigned int program_changes;
+    unsigned int draws;
+
+    RenderQueue();
+
+    // drops the queued draws and resets the counters, once per frame before the first submit()
+    void clear();
+    void submit(RenderPass pass, const DrawCommand& command, float depth01 = 0.0f);
+    size_t size() const { return commands.size(); }
+
+    // sorts and issues every submitted draw, then drops them (the counters stay)
+    void flush();
+
+    // sorts and issues the draws of every pass up to and including last, keeps the later passes queued for the next
+    // flush_through() / flush(), e.g. to switch framebuffers between passes. No submit() until the queue is flushed.
+    void flush_through(RenderPass last);
+
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order, scratch;
+    bool sorted;
+    size_t next; // first entry of order not issued yet
+
+    void drop_commands();
+
+    // LSD radix sort of order by keys, 8 bits per pass. Passes where every key shares the byte are skipped.
+    void sort();
+};
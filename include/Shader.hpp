@@ -1,17 +1,51 @@
 #pragma once
 #include <glad/glad.h>
+#include "GLState.hpp"
+#include "CameraUniforms.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// FNV-1a hash of a uniform name. constexpr so call sites can hash literal names at compile time.
+constexpr uint32_t uniform_hash(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	while(*name)
+	{
+		hash ^= static_cast<uint8_t>(*name++);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// uniform blocks and the binding point each one is attached to in every program that declares it
+const struct { const char* name; GLuint binding; } UNIFORM_BLOCK_BINDINGS[] =
+{
+	{ "Camera", CAMERA_BLOCK_BINDING },
+	{ "Lights", LIGHTS_BLOCK_BINDING },
+	{ "Clusters", CLUSTERS_BLOCK_BINDING },
+};
+
+// resolved uniform location, fetch once with Shader::uniform() and pass to Shader::set() every frame
+struct UniformHandle
+{
+	GLint location = -1;
+};
 
 class Shader
 {
 public:
 	unsigned int ID;
 
-	// generates shaders & program on demand
-	Shader(const char* vertexPath, const char* fragmentPath)
+	// generates shaders & program on demand. defines ("#define NAME\n" lines) are inserted after the #version line
+	// of both stages, so one source file can build several variants.
+	Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "")
 	{
 		std::string vertexCode;
 		std::string fragmentCode;
@@ -35,6 +69,8 @@ public:
 			// convert stream into string
 			vertexCode = vShaderStream.str();
 			fragmentCode = fShaderStream.str();
+			insertDefines(vertexCode, defines);
+			insertDefines(fragmentCode, defines);
 		}
 		catch(std::ifstream::failure& e)
 		{
@@ -65,44 +101,173 @@ public:
 		
 		glDeleteShader(vertexShader);
 		glDeleteShader(fragmentShader);
+
+		cacheUniformLocations();
+		bindUniformBlocks();
 	}
 
 	void use()
 	{
-		glUseProgram(ID);
+		gl_state().use_program(ID);
+	}
+
+	// uniform lookup. Only touches the location table built at link time, never the driver.
+	UniformHandle uniform(uint32_t nameHash) const
+	{
+		auto it = std::lower_bound(uniforms.begin(), uniforms.end(), nameHash,
+			[](const UniformEntry& entry, uint32_t hash) { return entry.hash < hash; });
+		if(it != uniforms.end() && it->hash == nameHash)
+			return { it->location };
+		return {};
+	}
+	UniformHandle uniform(const std::string& name) const
+	{
+		return uniform(uniform_hash(name.c_str()));
+	}
+
+	// handle based uniform functionality (no lookup at all)
+	void set(UniformHandle handle, bool value) const
+	{
+		glUniform1i(handle.location, (int)value);
+	}
+	void set(UniformHandle handle, int value) const
+	{
+		glUniform1i(handle.location, value);
+	}
+	void set(UniformHandle handle, float value) const
+	{
+		glUniform1f(handle.location, value);
+	}
+	void set(UniformHandle handle, const glm::vec3& value) const
+	{
+		glUniform3f(handle.location, value.x, value.y, value.z);
+	}
+	void set(UniformHandle handle, const glm::vec4& value) const
+	{
+		glUniform4f(handle.location, value.x, value.y, value.z, value.w);
+	}
+	void set(UniformHandle handle, const glm::mat3& value) const
+	{
+		glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+	void set(UniformHandle handle, const glm::mat4& value) const
+	{
+		glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
-	// uniform functionality
+	// name based uniform functionality (hashed table lookup)
 	void setBool(const std::string& name, bool value) const // const means we don't modify the actual member variables
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		set(uniform(name), value);
 	}
 	void setInt(const std::string& name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		set(uniform(name), value);
 	}
 	void setFloat(const std::string& name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		set(uniform(name), value);
 	}
 	void setVec3(const std::string& name, glm::vec3 value) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z);
+		set(uniform(name), value);
 	}
 	void setVec4(const std::string& name, glm::vec4 value) const
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w);
+		set(uniform(name), value);
 	}
 	void setMat3(const std::string& name, glm::mat3 value) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+		set(uniform(name), value);
 	}
 	void setMat4(const std::string& name, glm::mat4 value) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+		set(uniform(name), value);
 	}
 
 private:
+	struct UniformEntry
+	{
+		uint32_t hash;
+		GLint location;
+	};
+	std::vector<UniformEntry> uniforms; // sorted by hash
+
+	// reads every active uniform once after linking into the flat location table
+	void cacheUniformLocations()
+	{
+		GLint nUniforms = 0, maxNameLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &nUniforms);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+		std::vector<char> nameBuffer(maxNameLength + 1);
+		for(GLint i = 0; i < nUniforms; i++)
+		{
+			GLsizei length = 0;
+			GLint arraySize = 0;
+			GLenum type;
+			glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &arraySize, &type, nameBuffer.data());
+			std::string name(nameBuffer.data(), length);
+
+			GLint location = glGetUniformLocation(ID, name.c_str());
+			if(location < 0) // lives in a uniform block
+				continue;
+			addUniform(name, location);
+
+			// arrays are reported as "name[0]", also register the bare name and every element
+			if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			{
+				std::string baseName = name.substr(0, name.size() - 3);
+				addUniform(baseName, location);
+				for(GLint element = 1; element < arraySize; element++)
+				{
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+				}
+			}
+		}
+
+		std::sort(uniforms.begin(), uniforms.end(),
+			[](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+	}
+
+	// GL 3.3 has no layout(binding = N), so blocks get their fixed binding points here
+	void bindUniformBlocks()
+	{
+		for(const auto& block : UNIFORM_BLOCK_BINDINGS)
+		{
+			GLuint index = glGetUniformBlockIndex(ID, block.name);
+			if(index != GL_INVALID_INDEX)
+				glUniformBlockBinding(ID, index, block.binding);
+		}
+	}
+
+	void addUniform(const std::string& name, GLint location)
+	{
+		uint32_t hash = uniform_hash(name.c_str());
+		for(const UniformEntry& entry : uniforms)
+		{
+			if(entry.hash == hash)
+			{
+				std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION::" << name << std::endl;
+				return;
+			}
+		}
+		uniforms.push_back({ hash, location });
+	}
+
+	static void insertDefines(std::string& code, const std::string& defines)
+	{
+		if(defines.empty())
+			return;
+		size_t version = code.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+		if(lineEnd == std::string::npos)
+			code = defines + code;
+		else
+			code.insert(lineEnd + 1, defines);
+	}
+
 	void checkCompileErrors(GLuint shader, std::string type)
 	{
 		int success;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include "MeshArena.hpp"
+
+///////////////////////////
+// SierpinskiMesh: Sierpinski triangle geometry (pos + color) kept alive in a MeshArena (FORMAT_COLORED).
+//                 Regenerated only when the corner vertices or degree change.
+///////////////////////////
+class SierpinskiMesh
+{
+public:
+    SierpinskiMesh(MeshArena& arena);
+
+    // no-op when (v1, v2, v3, degree) matches the cached mesh
+    void update(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree);
+
+    void draw() const;
+
+    size_t vertex_count() const { return vertices.size() / FLOATS_PER_VERTEX; }
+    const MeshRange& range() const { return mesh; }
+
+    void destroy();
+
+private:
+    static const int FLOATS_PER_VERTEX = 6;
+
+    MeshArena& arena;
+    MeshRange mesh;
+
+    glm::vec3 corners[3];
+    int degree;
+    bool generated;
+    std::vector<float> vertices;
+
+    void generate();
+    void subdivide(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int depth);
+};
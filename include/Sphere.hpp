@@ -6,6 +6,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include <map>
+#include "Mesh.hpp"
 
 #ifndef M_PI 	// manually defined pi constant for use in calculations
 #define M_PI 3.14159265358979323846
@@ -14,24 +16,30 @@
 ///////////////////////////
 // Sphere: 3D closed surface where every point is same distance from a given point. 
 //              x^2 + y^2 + z^2 = r^2
-///////////////////////////     TODO
-
-
-// class Sphere 
-// {
-// public:
-
-//     Sphere();
-
-//     void initializeData()
-//     {
-//         // pre-calc sines/cosines for given number of stacks
-//         const auto stackAngleStep = -M_PI / float(nStacks);
-//         auto currStackAngle = M_PI / 2.0f;
-//         std::vector stackSines, stackCosines;
-//         for(auto i = 0; i <= nStacks; i++)
-//         {
-
-//         }
-//     }
-// };
\ No newline at end of file
+//         Unit radius UV sphere (scale it with the model matrix). Meshes are cached by (stacks, sectors),
+//         so asking for the same sphere again costs a map lookup.
+///////////////////////////
+class Sphere 
+{
+public:
+    static const int MIN_STACKS = 4;
+    static const int MIN_SECTORS = 6;
+
+    // unit sphere with interleaved pos/normal/uv and indexed triangles, generated on first request
+    static const MeshData& get(int nStacks, int nSectors);
+
+    // LOD chain starting at (nStacks, nSectors), halving both per level down to (MIN_STACKS, MIN_SECTORS)
+    static std::vector<const MeshData*> get_lod_chain(int nStacks, int nSectors, int nLevels);
+
+private:
+    struct TrigTable
+    {
+        std::vector<float> sines;
+        std::vector<float> cosines;
+    };
+
+    // sin/cos of every stack (or sector) angle, computed once per count
+    static const TrigTable& get_trig_table(int nSteps, double startAngle, double angleStep);
+
+    static MeshData generate(int nStacks, int nSectors);
+};
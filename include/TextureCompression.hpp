@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// S3TC isn't core in 3.3 (RGTC is), glad was generated without the extension
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+///////////////////////////
+// Texture compression: CPU encoders for the 4x4 block formats every desktop GPU samples natively.
+//   BC1 (DXT1)  RGB,              8 bytes per block (6:1 vs RGB8)
+//   BC3 (DXT5)  RGBA,            16 bytes per block (4:1 vs RGBA8)
+//   BC4 (RGTC1) one channel,      8 bytes per block, specular / gloss / height maps
+//   BC5 (RGTC2) two channels,    16 bytes per block, tangent space normal maps (z rebuilt in the shader)
+// Endpoints come from the block's bounding box (inset, diagonal picked by covariance), indices from projecting
+// each pixel onto the endpoint axis, four pixels at a time with SSE2. Rows of blocks are split across threads.
+///////////////////////////
+
+enum BlockFormat
+{
+    BLOCK_BC1,
+    BLOCK_BC3,
+    BLOCK_BC4,
+    BLOCK_BC5
+};
+
+// picks BC4 for grey maps, BC5 for normal maps, BC1 when every pixel is opaque and BC3 otherwise
+BlockFormat choose_block_format(const unsigned char* pixels, int width, int height, int channels, bool normal_map);
+
+size_t block_compressed_size(BlockFormat format, int width, int height);
+GLenum block_gl_format(BlockFormat format, bool srgb);
+const char* block_format_name(BlockFormat format);
+
+// pixels: width * height * channels bytes (1-4 channels), any size, edge blocks repeat the last row / column.
+// BC4 encodes the first channel, BC5 the first two.
+void compress_blocks(BlockFormat format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out);
+
+// back to width * height RGBA8, for measuring quality. BC4 decodes to (r, r, r, 255), BC5 to (r, g, 0, 255).
+void decompress_blocks(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
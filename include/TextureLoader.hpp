@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "ThreadPool.hpp"
+#include "LockFreeQueue.hpp"
+#include "MipGenerator.hpp"
+
+// how a texture is sampled; part of a texture's identity, the same file loaded with different options is a different texture
+struct TextureOptions
+{
+    GLint wrap = GL_REPEAT;
+    bool mipmaps = true;
+    bool srgb = false;
+
+    bool operator==(const TextureOptions& other) const
+    {
+        return wrap == other.wrap && mipmaps == other.mipmaps && srgb == other.srgb;
+    }
+};
+
+// pixels decoded on a worker, waiting for the GL thread to upload them into texture
+struct DecodedImage
+{
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = nullptr; // stbi owned, freed after upload
+    std::vector<MipLevel> mips;      // levels 1..n when options.mipmaps
+    uint64_t content_hash = 0;       // of dimensions, channels and pixels, computed on the worker
+    TextureOptions options;
+    std::string path;
+};
+
+uint64_t hash_pixels(const unsigned char* pixels, int width, int height, int channels);
+
+///////////////////////////
+// TextureLoader: asynchronous replacement for loadTexture(). load() returns a texture name right away that
+//                holds a 1x1 placeholder; a worker decodes the file and hands the pixels back through a
+//                lock-free queue, and pump() uploads them through PBOs on the GL thread within a time budget.
+//                The texture name never changes, so whatever already binds it picks up the real image.
+///////////////////////////
+class TextureLoader
+{
+public:
+    // decodes and uploads finished by the last pump()
+    unsigned int uploaded_last_pump;
+    // GL thread, called for each decoded image (pixels is null if decoding failed) before it is uploaded;
+    // returning false skips the upload and leaves the placeholder texture for the caller to delete
+    std::function<bool(const DecodedImage&)> on_decoded;
+
+    explicit TextureLoader(unsigned int n_workers = 0, size_t queue_capacity = 64);
+    ~TextureLoader();
+
+    GLuint load(const std::string& path, const TextureOptions& options = TextureOptions());
+
+    // GL thread: uploads decoded images until budget_ms is spent (always at least one if any are ready)
+    unsigned int pump(double budget_ms);
+
+    // blocks until every requested texture is uploaded (startup / level load screens)
+    void finish();
+
+    // textures requested but not uploaded yet
+    size_t pending() const { return in_flight.load(); }
+
+    void destroy();
+
+private:
+    LockFreeQueue<DecodedImage> decoded;
+    std::atomic<size_t> in_flight;
+    std::atomic<bool> stopping;
+    GLuint pbos[2];
+    int next_pbo;
+    ThreadPool workers; // last member: its destructor joins the workers before the queue goes away
+
+    void upload(DecodedImage& image);
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include "TextureLoader.hpp"
+#include "TexturePack.hpp"
+
+// refcounted reference to a managed texture; acquire()/retain() add a reference, release() drops one
+struct TextureHandle
+{
+    int id = -1;
+    bool valid() const { return id >= 0; }
+};
+
+///////////////////////////
+// TextureManager: owns every texture loaded from disk. Textures are keyed by normalized path + options, so
+//                 asking for the same file twice returns the same texture, and after decoding, files with
+//                 identical pixels share one GL texture (keyed by content hash). Textures nobody references
+//                 stay cached until resident memory goes over the budget, then the least recently released
+//                 ones are deleted.
+///////////////////////////
+class TextureManager
+{
+public:
+    // counters for the memory report
+    size_t evictions;
+    size_t deduplicated;
+
+    TextureManager(TextureLoader& loader, size_t vram_budget_bytes = 256ull << 20);
+
+    // textures found in the pack are uploaded from it synchronously, anything else goes through the loader
+    void set_pack(const TexturePack* pack) { this->pack = pack; }
+
+    TextureHandle acquire(const std::string& path, const TextureOptions& options = TextureOptions());
+    void retain(TextureHandle handle);
+    void release(TextureHandle handle);
+
+    // GL name to bind this frame; can change once when a duplicate is folded into an existing texture
+    GLuint texture(TextureHandle handle) const;
+
+    // evicts unreferenced textures until resident memory fits the budget
+    void trim();
+    void set_budget(size_t bytes);
+    size_t budget() const { return vram_budget; }
+    size_t resident_bytes() const { return resident; }
+    size_t texture_count() const { return gpu_textures.size() - free_gpu.size(); }
+    void print_report() const;
+
+    void destroy();
+
+private:
+    // one GL texture, possibly shared by several entries with identical content
+    struct GpuTexture
+    {
+        GLuint name = 0;
+        uint64_t content_key = 0;
+        size_t bytes = 0;
+        int width = 0, height = 0, channels = 0; // of a decoded image, 0 for pack textures
+        int users = 0;       // entries pointing here
+        bool ready = false;  // decoded and uploaded; pending textures are never evicted
+    };
+    // one path + options
+    struct Entry
+    {
+        std::string key;
+        int gpu = -1;
+        int refs = 0;
+        std::list<int>::iterator lru; // valid while refs == 0
+    };
+
+    TextureLoader& loader;
+    const TexturePack* pack;
+    size_t vram_budget;
+    size_t resident;
+
+    std::vector<Entry> entries;
+    std::vector<int> free_entries;
+    std::vector<GpuTexture> gpu_textures;
+    std::vector<int> free_gpu;
+    std::unordered_map<std::string, int> by_key;      // normalized path + options -> entry
+    std::unordered_map<uint64_t, int> by_content;     // content hash + options -> gpu texture
+    std::unordered_map<GLuint, int> pending_by_name;  // placeholder name -> gpu texture waiting on the loader
+    std::list<int> unreferenced;                      // entries with refs == 0, least recently released first
+
+    bool on_decoded(const DecodedImage& image);
+    bool same_pixels(const GpuTexture& texture, const DecodedImage& image) const;
+    void evict(int entry);
+    void drop_gpu_user(int gpu);
+    int new_entry();
+    int new_gpu_texture();
+    int acquire_from_pack(const TexturePackEntry& cooked, const TextureOptions& options);
+};
+
+// lexically normalized path with forward slashes ("res/./a\\..\\b.png" -> "res/b.png"), lower case on Windows
+std::string normalize_texture_path(const std::string& path);
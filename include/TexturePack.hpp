@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cassert>
+#include <string>
+#include <unordered_map>
+#include "TexturePackFormat.hpp"
+#include "TextureLoader.hpp"
+
+///////////////////////////
+// TexturePack: read-only view of a pack written by tools/texture_cooker. The file is memory mapped and every
+//              mip level is handed to GL straight from the mapping, no decoding, parsing or copying.
+///////////////////////////
+class TexturePack
+{
+public:
+    TexturePack();
+
+    // false if the file is missing, not a pack of this version or any entry points outside it; the caller
+    // falls back to decoding images
+    bool open(const std::string& path);
+    bool is_open() const { return data != nullptr; }
+
+    // entry names are relative to the pack's directory: "../res/textures.pack" has "wall.jpg" as "../res/wall.jpg"
+    // (or the same file by absolute path)
+    const TexturePackEntry* find(const std::string& path) const;
+
+    // creates a texture with every cooked level; binds to unit 0
+    GLuint upload(const TexturePackEntry& entry, const TextureOptions& options) const;
+
+    // start of a level's data inside the mapping, ready for gl(Compressed)TexImage2D. open() checked every level
+    // of every entry lies inside the file, so only level needs checking here.
+    const unsigned char* level_data(const TexturePackEntry& entry, uint32_t level) const
+    {
+        assert(level < entry.level_count);
+        return data + entry.levels[level].offset;
+    }
+
+    // sum of the level sizes, what upload() puts in video memory
+    size_t entry_bytes(const TexturePackEntry& entry) const;
+
+    uint32_t texture_count() const { return header ? header->texture_count : 0; }
+
+    void close();
+
+private:
+    const unsigned char* data;
+    size_t size;
+    const TexturePackHeader* header;
+    const TexturePackEntry* entries;
+    std::unordered_map<std::string, uint32_t> by_name; // normalized entry name -> index
+    #ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+    #endif
+};
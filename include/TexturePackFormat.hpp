@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+///////////////////////////
+// Texture pack file layout, shared by tools/texture_cooker.cpp (writer) and TexturePack (reader).
+//   TexturePackHeader
+//   TexturePackEntry[texture_count]
+//   level data, each level 16 byte aligned, laid out exactly as glTexImage2D / glCompressedTexImage2D take it
+// Everything is little endian and read in place from the mapped file.
+///////////////////////////
+
+const uint32_t TEXTURE_PACK_MAGIC = 0x4B415054; // "TPAK"
+const uint32_t TEXTURE_PACK_VERSION = 1;
+const int TEXTURE_PACK_MAX_LEVELS = 16;
+const int TEXTURE_PACK_NAME_SIZE = 64;
+const uint32_t TEXTURE_PACK_ALIGNMENT = 16;
+
+struct TexturePackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t texture_count;
+    uint32_t reserved;
+};
+
+struct TexturePackLevel
+{
+    uint64_t offset; // from the start of the file
+    uint32_t size;   // bytes
+    uint16_t width;
+    uint16_t height;
+};
+
+struct TexturePackEntry
+{
+    char name[TEXTURE_PACK_NAME_SIZE]; // path relative to the cooked directory, '/' separated, null terminated
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t internal_format; // GL enums
+    uint32_t format;          // 0 for compressed formats
+    uint32_t type;            // 0 for compressed formats
+    uint32_t channels;        // of the source image
+    uint32_t flags;           // TEXTURE_PACK_* below
+    TexturePackLevel levels[TEXTURE_PACK_MAX_LEVELS];
+};
+
+const uint32_t TEXTURE_PACK_COMPRESSED = 1;
+const uint32_t TEXTURE_PACK_SWIZZLE_RED = 2; // single channel stored, sample it as grey (r, r, r, 1)
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include "TexturePack.hpp"
+#include "ThreadPool.hpp"
+#include "LockFreeQueue.hpp"
+
+// a streamed texture, valid for the streamer's lifetime
+struct StreamHandle
+{
+    int id = -1;
+    bool valid() const { return id >= 0; }
+};
+
+///////////////////////////
+// TextureStreamer: keeps only the mips each texture needs in video memory. Textures start with their small tail
+//                  levels; every frame the caller reports how big each texture appears on screen, the streamer works
+//                  out the finest mip that size can show and brings it in one level at a time. A worker faults the
+//                  level's pages of the mapped pack in, then the GL thread uploads it straight from the mapping and
+//                  lowers GL_TEXTURE_BASE_LEVEL. The texture name never changes. When resident bytes go over the
+//                  budget, the top levels of the least recently used textures are released again.
+///////////////////////////
+class TextureStreamer
+{
+public:
+    // counters
+    size_t resident_bytes;
+    size_t evictions;       // levels released for the budget
+    size_t uploads;         // levels streamed in
+    size_t pending() const { return in_flight.load(); }
+
+    TextureStreamer(const TexturePack& pack, size_t budget_bytes = 64ull << 20, unsigned int max_in_flight = 4);
+
+    // the texture with every level up to MIN_RESIDENT_SIZE resident, invalid if the path isn't in the pack
+    StreamHandle add(const std::string& path);
+
+    // this frame the texture covers about screen_pixels pixels across (see projected_pixels); call it for every
+    // use, the largest wins
+    void request(StreamHandle handle, float screen_pixels);
+
+    // GL thread, once per frame: uploads finished levels, issues new reads, enforces the budget
+    void update();
+
+    GLuint texture(StreamHandle handle) const { return textures[handle.id].name; }
+    int resident_level(StreamHandle handle) const { return textures[handle.id].resident_top; }
+    int wanted_level(StreamHandle handle) const { return textures[handle.id].wanted_top; }
+
+    void set_budget(size_t bytes) { budget = bytes; }
+    size_t get_budget() const { return budget; }
+    void print_report() const;
+
+    void destroy();
+
+    // levels this size and smaller are always resident
+    static const int MIN_RESIDENT_SIZE = 64;
+
+private:
+    struct StreamedTexture
+    {
+        const TexturePackEntry* entry;
+        GLuint name;
+        int resident_top;   // finest resident level
+        int wanted_top;     // finest level asked for since the last update
+        int pinned_top;     // resident_top never goes above this (the always resident tail)
+        bool loading;       // a read of resident_top - 1 is in flight
+        uint64_t last_used; // frame
+    };
+    struct LoadedLevel
+    {
+        int texture;
+        int level;
+    };
+
+    const TexturePack& pack;
+    size_t budget;
+    unsigned int max_in_flight;
+    uint64_t frame;
+    std::vector<StreamedTexture> textures;
+    LockFreeQueue<LoadedLevel> loaded;
+    std::atomic<unsigned int> in_flight;
+    std::atomic<bool> stopping;
+    ThreadPool io; // last member: joined before the queue goes away
+
+    void upload_level(StreamedTexture& texture, int level);
+    void release_top_level(StreamedTexture& texture);
+    bool evict_one(uint64_t protect_frame);
+};
+
+// how many pixels across an object of this radius covers at this distance
+float projected_pixels(float radius, float distance, float fovY, float screenHeight);
+
+// finest mip worth having for a texture of texture_size texels stretched over screen_pixels pixels
+int mip_for_screen_size(int texture_size, float screen_pixels, int level_count);
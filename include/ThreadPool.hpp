@@ -0,0 +1,42 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+///////////////////////////
+// ThreadPool: fixed set of worker threads running submitted jobs in FIFO order.
+//             Used for work that outlives a frame (texture decode); per-frame data parallel loops use parallel_for.
+///////////////////////////
+class ThreadPool
+{
+public:
+    // 0 threads = one per hardware thread
+    explicit ThreadPool(unsigned int n_threads = 0);
+    // jobs that have not started are dropped
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    // blocks until the queue is empty and no job is running
+    void wait_idle();
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable job_available;
+    std::condition_variable idle;
+    unsigned int running;
+    bool stopping;
+
+    void worker_loop();
+};
@@ -2,27 +2,24 @@
 
 #include <glad/glad.h>
 #include <vector>
+#include <cstddef>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+///////////////////////////
+// Sierpinski triangle as instance transforms: every leaf is the base triangle (-1,-1), (1,-1), (0,1)
+// scaled by 0.5^degree and translated. Level k of the subdivision picks one of three offsets, so the
+// base-3 digits of a leaf's index fully describe its transform:
+//          translation = sum_k 0.5^(k+1) * offset[digit_k]
+///////////////////////////
 
-void generate_sierpinksi(std::vector<glm::mat4> transformations, glm::mat4 current_transformation, int degree)
-{
-    if(degree == 0)
-    {
-        transformations.push_back(current_transformation);
-        return;
-    }
+// number of leaf transforms for a given degree (3^degree)
+size_t sierpinski_leaf_count(int degree);
 
-    glm::mat4 scale = glm::scale(current_transformation, glm::vec3(0.5f));
-    generate_sierpinksi(transformations, glm::translate(scale, glm::vec3(-1, -1, 0)), degree--);
-    generate_sierpinksi(transformations, glm::translate(scale, glm::vec3(1, -1, 0)), degree--);
-    generate_sierpinksi(transformations, glm::translate(scale, glm::vec3(0, 1, 0)), degree--);
-}
+// writes all sierpinski_leaf_count(degree) leaf transforms into out, each computed in closed form from its index.
+// Leaves are independent, so the work is split across threads.
+void generate_sierpinski(glm::mat4* out, int degree, const glm::mat4& root = glm::mat4(1.0f));
 
-void setup_sierpinski(std::vector<glm::mat4> transformations, int degree)
-{
-    transformations.clear(); // Clear previous
-    generate_sierpinksi(transformations, glm::mat4(1), degree);
-}
\ No newline at end of file
+// resizes transformations to the leaf count and fills it
+void setup_sierpinski(std::vector<glm::mat4>& transformations, int degree, const glm::mat4& root = glm::mat4(1.0f));
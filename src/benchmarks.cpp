@@ -0,0 +1,535 @@
+#include "Benchmarks.hpp"
+#include "sierpinski.hpp"
+#include "Parallel.hpp"
+#include "Cone.hpp"
+#include "TextureCompression.hpp"
+#include "LightClusters.hpp"
+#include "Culling.hpp"
+#include "Bvh.hpp"
+#include "OcclusionCuller.hpp"
+#include "OffsetAllocator.hpp"
+#include "stb_image.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    double elapsed_ns(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    // reference: the recursive sierpinski generator, one matrix product per node
+    void generate_sierpinski_recursive(std::vector<glm::mat4>& transformations, const glm::mat4& current_transformation, int degree)
+    {
+        if(degree == 0)
+        {
+            transformations.push_back(current_transformation);
+            return;
+        }
+
+        glm::mat4 scale = glm::scale(current_transformation, glm::vec3(0.5f));
+        generate_sierpinski_recursive(transformations, glm::translate(scale, glm::vec3(-1, -1, 0)), degree - 1);
+        generate_sierpinski_recursive(transformations, glm::translate(scale, glm::vec3(1, -1, 0)), degree - 1);
+        generate_sierpinski_recursive(transformations, glm::translate(scale, glm::vec3(0, 1, 0)), degree - 1);
+    }
+}
+
+void benchmark_uniform_upload(Shader& shader)
+{
+    const int N_DRAWS = 100000;
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(1.0f, 0.3f, 0.5f));
+    glm::mat4 normalMat = glm::transpose(glm::inverse(model));
+    shader.use();
+    glFinish();
+
+    // before: a std::string and a driver lookup for every upload
+    auto start = Clock::now();
+    for(int i = 0; i < N_DRAWS; i++)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("model").c_str()), 1, GL_FALSE, glm::value_ptr(model));
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, std::string("normalMat").c_str()), 1, GL_FALSE, glm::value_ptr(normalMat));
+    }
+    glFinish();
+    double lookup_ns = elapsed_ns(start) / N_DRAWS;
+
+    // name based set*, resolved through the shader's hashed location table
+    start = Clock::now();
+    for(int i = 0; i < N_DRAWS; i++)
+    {
+        shader.setMat4("model", model);
+        shader.setMat4("normalMat", normalMat);
+    }
+    glFinish();
+    double table_ns = elapsed_ns(start) / N_DRAWS;
+
+    // after: handles resolved once up front
+    const UniformHandle modelLoc = shader.uniform(uniform_hash("model"));
+    const UniformHandle normalMatLoc = shader.uniform(uniform_hash("normalMat"));
+    start = Clock::now();
+    for(int i = 0; i < N_DRAWS; i++)
+    {
+        shader.set(modelLoc, model);
+        shader.set(normalMatLoc, normalMat);
+    }
+    glFinish();
+    double handle_ns = elapsed_ns(start) / N_DRAWS;
+
+    std::cout << "BENCHMARK::UNIFORM_UPLOAD (2 x mat4 per draw, " << N_DRAWS << " draws)\n"
+              << "    glGetUniformLocation: " << lookup_ns << " ns/draw\n"
+              << "    hashed name table:    " << table_ns << " ns/draw\n"
+              << "    cached handle:        " << handle_ns << " ns/draw" << std::endl;
+}
+
+void benchmark_sierpinski()
+{
+    std::cout << "BENCHMARK::SIERPINSKI_TRANSFORMS (" << worker_count() << " threads)" << std::endl;
+    for(int degree = 8; degree <= 14; degree++)
+    {
+        size_t count = sierpinski_leaf_count(degree);
+
+        std::vector<glm::mat4> reference;
+        reference.reserve(count);
+        auto start = Clock::now();
+        generate_sierpinski_recursive(reference, glm::mat4(1.0f), degree);
+        double recursive_ms = elapsed_ns(start) * 1e-6;
+
+        std::vector<glm::mat4> transforms(count);
+        start = Clock::now();
+        generate_sierpinski(transforms.data(), degree);
+        double closed_form_ms = elapsed_ns(start) * 1e-6;
+
+        // both visit leaves in the same order, so they must agree element for element
+        float max_error = 0.0f;
+        for(size_t i = 0; i < count; i++)
+            max_error = glm::max(max_error, glm::length(glm::vec3(transforms[i][3] - reference[i][3])));
+
+        std::cout << "    degree " << degree << " (" << count << " leaves): recursive " << recursive_ms
+                  << " ms, closed form " << closed_form_ms << " ms (" << count / (closed_form_ms * 1e3) << " M leaves/s)"
+                  << ", max error " << max_error << std::endl;
+    }
+}
+
+void benchmark_cone_generation()
+{
+    std::cout << "BENCHMARK::CONE_GENERATION" << std::endl;
+    for(int nSectors = 8; nSectors <= 256; nSectors *= 2)
+    {
+        const int N_MESHES = 2000;
+        size_t n_vertices = 0;
+        auto start = Clock::now();
+        for(int i = 0; i < N_MESHES; i++)
+            n_vertices += Cone::build_vertices_smooth(nSectors, 4).vertices.size();
+        double seconds = elapsed_ns(start) * 1e-9;
+        std::cout << "    " << nSectors << " sectors: " << N_MESHES / seconds << " meshes/s, "
+                  << n_vertices / seconds * 1e-6 << " M vertices/s" << std::endl;
+    }
+
+    // spawning: every cone after the first is a cache hit
+    const int N_SPAWNS = 1000000;
+    size_t checksum = 0;
+    auto start = Clock::now();
+    for(int i = 0; i < N_SPAWNS; i++)
+        checksum += Cone::get(8 << (i % 4), 4).indices.size();
+    double spawn_ns = elapsed_ns(start) / N_SPAWNS;
+    std::cout << "    cached spawn: " << spawn_ns << " ns/cone (checksum " << checksum << ")" << std::endl;
+}
+
+void benchmark_texture_compression()
+{
+    const char* FILES[] = { "../res/container2.png", "../res/container2_specular.png", "../res/StoneFloorTexture.png",
+                            "../res/wall.jpg", "../res/matrix_emission_map.jpg" };
+    const int N_RUNS = 3;
+    std::cout << "BENCHMARK::TEXTURE_COMPRESSION (" << worker_count() << " threads, best of " << N_RUNS << ")" << std::endl;
+    for(const char* file : FILES)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(file, &width, &height, &channels, 0);
+        if(!pixels)
+        {
+            std::cout << "    " << file << ": failed to load" << std::endl;
+            continue;
+        }
+
+        // every format that makes sense for the image, the one the cooker would pick first
+        std::vector<BlockFormat> formats = { choose_block_format(pixels, width, height, channels, false) };
+        if(formats[0] != BLOCK_BC1 && channels >= 3)
+            formats.push_back(BLOCK_BC1);
+        if(formats[0] != BLOCK_BC3 && channels == 4)
+            formats.push_back(BLOCK_BC3);
+
+        std::vector<unsigned char> decoded((size_t)width * height * 4);
+        for(BlockFormat format : formats)
+        {
+            std::vector<unsigned char> blocks(block_compressed_size(format, width, height));
+            double best_ns = 1e30;
+            for(int run = 0; run < N_RUNS; run++)
+            {
+                auto start = Clock::now();
+                compress_blocks(format, pixels, width, height, channels, blocks.data());
+                best_ns = std::min(best_ns, elapsed_ns(start));
+            }
+
+            // PSNR over the channels the format stores
+            decompress_blocks(format, blocks.data(), width, height, decoded.data());
+            int n_compared = format == BLOCK_BC4 ? 1 : format == BLOCK_BC5 ? 2 : format == BLOCK_BC1 ? 3 : std::min(channels, 4);
+            double squared_error = 0.0;
+            for(size_t i = 0; i < (size_t)width * height; i++)
+            {
+                for(int c = 0; c < n_compared; c++)
+                {
+                    int source = channels == 1 ? pixels[i] : pixels[i * channels + std::min(c, channels - 1)];
+                    int diff = source - decoded[i * 4 + c];
+                    squared_error += diff * diff;
+                }
+            }
+            double mse = squared_error / ((double)width * height * n_compared);
+            double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+            double input_mb = (double)width * height * channels / (1024.0 * 1024.0);
+            std::cout << "    " << file << " " << width << "x" << height << "x" << channels << " -> " << block_format_name(format)
+                      << ": " << psnr << " dB, " << input_mb / (best_ns * 1e-9) << " MB/s, "
+                      << (double)width * height * channels / blocks.size() << ":1" << std::endl;
+        }
+        stbi_image_free(pixels);
+    }
+}
+
+void benchmark_light_binning()
+{
+    const int N_LIGHTS = 10000;
+    const int N_RUNS = 20;
+
+    // the main camera's projection, looking down -z from the origin
+    ClusterGrid grid;
+    grid.set_projection(80.0f, 4.0f / 3.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // deterministic scatter through a box around the frustum, ranges 1-5
+    std::vector<Light> lights;
+    lights.reserve(N_LIGHTS);
+    uint32_t seed = 12345;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+    for(int i = 0; i < N_LIGHTS; i++)
+    {
+        glm::vec3 position(-80.0f + 160.0f * next(), -60.0f + 120.0f * next(), -100.0f * next());
+        lights.push_back(make_point_light(position, glm::vec3(1.0f), 1.0f + 4.0f * next()));
+    }
+
+    std::cout << "BENCHMARK::LIGHT_BINNING " << N_LIGHTS << " lights into " << CLUSTER_X << "x" << CLUSTER_Y << "x" << CLUSTER_Z
+              << " clusters, " << worker_count() << " threads" << std::endl;
+    double best_ns = 1e30;
+    for(int run = 0; run < N_RUNS; run++)
+    {
+        auto start = Clock::now();
+        grid.bin(lights.data(), lights.size(), view);
+        best_ns = std::min(best_ns, elapsed_ns(start));
+    }
+
+    size_t occupied = 0, most = 0;
+    for(const glm::uvec2& range : grid.clusters)
+    {
+        occupied += range.y ? 1 : 0;
+        most = std::max<size_t>(most, range.y);
+    }
+    std::cout << "    " << best_ns * 1e-6 << " ms, " << grid.lights.size() << " lights in depth range, " << grid.indices.size()
+              << " indices, " << occupied << " clusters lit (" << (occupied ? (double)grid.indices.size() / occupied : 0.0)
+              << " lights avg, " << most << " max)" << std::endl;
+}
+
+void benchmark_frustum_culling()
+{
+    const int N_OBJECTS = 1000000;
+    const int N_RUNS = 10;
+
+    // objects scattered through a 400^3 box around a camera at the origin, a few percent of them in view
+    Frustum frustum = Frustum::from_matrix(glm::perspective(glm::radians(80.0f), 4.0f / 3.0f, 0.1f, 100.0f)
+                                         * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    CullBounds bounds;
+    bounds.reserve(N_OBJECTS);
+    uint32_t seed = 6789;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+    for(int i = 0; i < N_OBJECTS; i++)
+    {
+        glm::vec3 center(-200.0f + 400.0f * next(), -200.0f + 400.0f * next(), -200.0f + 400.0f * next());
+        glm::vec3 extent(0.5f + 2.0f * next(), 0.5f + 2.0f * next(), 0.5f + 2.0f * next());
+        bounds.add_aabb(center - extent, center + extent);
+    }
+    std::vector<uint32_t> visible(N_OBJECTS);
+
+    auto time_best = [&](auto&& cull)
+    {
+        double best_ns = 1e30;
+        size_t count = 0;
+        for(int run = 0; run < N_RUNS; run++)
+        {
+            auto start = Clock::now();
+            count = cull();
+            best_ns = std::min(best_ns, elapsed_ns(start));
+        }
+        return std::make_pair(best_ns, count);
+    };
+    auto report = [&](const char* name, std::pair<double, size_t> result)
+    {
+        std::cout << "    " << name << ": " << result.first * 1e-6 << " ms, " << result.first / N_OBJECTS << " ns / object, "
+                  << result.second << " visible" << std::endl;
+    };
+
+    std::cout << "BENCHMARK::FRUSTUM_CULLING " << N_OBJECTS << " objects" <<
+    #ifdef __AVX__
+        " (AVX)" <<
+    #else
+        " (SSE)" <<
+    #endif
+        std::endl;
+    report("scalar spheres", time_best([&]()
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < bounds.size(); i++)
+            if(frustum.intersects_sphere(glm::vec3(bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]), bounds.radius[i]))
+                visible[count++] = (uint32_t)i;
+        return count;
+    }));
+    report("scalar AABBs", time_best([&]()
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < bounds.size(); i++)
+            if(frustum.intersects_aabb(glm::vec3(bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]),
+                                       glm::vec3(bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i])))
+                visible[count++] = (uint32_t)i;
+        return count;
+    }));
+    report("SIMD spheres", time_best([&]() { return cull_spheres(frustum, bounds, visible.data()); }));
+    report("SIMD AABBs", time_best([&]() { return cull_aabbs(frustum, bounds, visible.data()); }));
+}
+
+void benchmark_bvh()
+{
+    const int N_OBJECTS = 1000000;
+    const int N_RAYS = 10000;
+
+    // same scene as benchmark_frustum_culling
+    Frustum frustum = Frustum::from_matrix(glm::perspective(glm::radians(80.0f), 4.0f / 3.0f, 0.1f, 100.0f)
+                                         * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    CullBounds bounds;
+    bounds.reserve(N_OBJECTS);
+    uint32_t seed = 6789;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+    for(int i = 0; i < N_OBJECTS; i++)
+    {
+        glm::vec3 center(-200.0f + 400.0f * next(), -200.0f + 400.0f * next(), -200.0f + 400.0f * next());
+        glm::vec3 extent(0.5f + 2.0f * next(), 0.5f + 2.0f * next(), 0.5f + 2.0f * next());
+        bounds.add_aabb(center - extent, center + extent);
+    }
+    std::vector<uint32_t> visible(N_OBJECTS);
+
+    std::cout << "BENCHMARK::BVH " << N_OBJECTS << " objects, " << worker_count() << " threads" << std::endl;
+    Bvh bvh;
+    auto start = Clock::now();
+    bvh.build(bounds);
+    std::cout << "    build: " << elapsed_ns(start) * 1e-6 << " ms, " << bvh.nodes.size() << " nodes, depth " << bvh.depth() << std::endl;
+
+    for(float& x : bounds.center_x)
+        x += 1.0f;
+    start = Clock::now();
+    bvh.refit(bounds);
+    std::cout << "    refit: " << elapsed_ns(start) * 1e-6 << " ms" << std::endl;
+
+    start = Clock::now();
+    size_t n_visible = bvh.cull(frustum, visible.data());
+    double bvh_ns = elapsed_ns(start);
+    start = Clock::now();
+    cull_aabbs(frustum, bounds, visible.data());
+    double linear_ns = elapsed_ns(start);
+    std::cout << "    cull: " << bvh_ns * 1e-6 << " ms hierarchical vs " << linear_ns * 1e-6 << " ms linear, " << n_visible << " visible" << std::endl;
+
+    size_t hits = 0;
+    start = Clock::now();
+    for(int i = 0; i < N_RAYS; i++)
+    {
+        glm::vec3 direction = glm::normalize(glm::vec3(next() - 0.5f, next() - 0.5f, next() - 0.5f) + glm::vec3(1e-4f));
+        BvhHit hit;
+        hits += bvh.raycast(glm::vec3(0.0f), direction, 1000.0f, hit) ? 1 : 0;
+    }
+    double ray_ns = elapsed_ns(start);
+    std::cout << "    raycast: " << ray_ns / N_RAYS << " ns / ray, " << hits << " of " << N_RAYS << " hit" << std::endl;
+}
+
+void benchmark_occlusion_culling()
+{
+    const int GRID = 46; // 46^3 ~ 100k cubes
+    const int N_RUNS = 10;
+
+    // closed unit cube, counter-clockwise seen from outside
+    MeshData box;
+    for(int corner = 0; corner < 8; corner++)
+        box.vertices.push_back({ glm::vec3((corner & 1) ? 0.5f : -0.5f, (corner & 2) ? 0.5f : -0.5f, (corner & 4) ? 0.5f : -0.5f), glm::vec3(0.0f), glm::vec2(0.0f) });
+    box.indices = { 0, 2, 3, 0, 3, 1,  4, 5, 7, 4, 7, 6,  0, 4, 6, 0, 6, 2,  1, 3, 7, 1, 7, 5,  0, 1, 5, 0, 5, 4,  2, 6, 7, 2, 7, 3 };
+
+    glm::mat4 projection_view = glm::perspective(glm::radians(80.0f), 4.0f / 3.0f, 0.1f, 100.0f)
+                              * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    // a 4 x 3 wall of slabs 8 units ahead with gaps between them, cubes in a block behind it
+    std::vector<glm::mat4> occluders;
+    for(int y = 0; y < 3; y++)
+        for(int x = 0; x < 4; x++)
+            occluders.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-6.0f + 4.0f * x, -3.5f + 3.5f * y, -8.0f)), glm::vec3(3.6f, 3.1f, 0.5f)));
+    CullBounds bounds;
+    for(int z = 0; z < GRID; z++)
+        for(int y = 0; y < GRID; y++)
+            for(int x = 0; x < GRID; x++)
+            {
+                glm::vec3 center(-23.0f + x, -23.0f + y, -12.0f - z);
+                bounds.add_aabb(center - glm::vec3(0.3f), center + glm::vec3(0.3f));
+            }
+    std::vector<uint32_t> candidates(bounds.size());
+    size_t n_candidates = cull_aabbs(Frustum::from_matrix(projection_view), bounds, candidates.data());
+    std::vector<uint32_t> visible(n_candidates);
+
+    OcclusionCuller culler;
+    double best_raster_ns = 1e30, best_test_ns = 1e30;
+    size_t n_visible = 0;
+    for(int run = 0; run < N_RUNS; run++)
+    {
+        auto start = Clock::now();
+        culler.begin(projection_view);
+        for(const glm::mat4& model : occluders)
+            culler.add_occluder(box, model);
+        culler.rasterize();
+        best_raster_ns = std::min(best_raster_ns, elapsed_ns(start));
+
+        start = Clock::now();
+        n_visible = culler.cull(bounds, candidates.data(), n_candidates, visible.data());
+        best_test_ns = std::min(best_test_ns, elapsed_ns(start));
+    }
+    std::cout << "BENCHMARK::OCCLUSION_CULLING " << culler.width() << "x" << culler.height() << " depth, " << occluders.size()
+              << " occluders (" << culler.occluder_triangles << " triangles), " << worker_count() << " threads" << std::endl;
+    std::cout << "    rasterize + Hi-Z: " << best_raster_ns * 1e-3 << " us" << std::endl;
+    std::cout << "    test: " << best_test_ns * 1e-6 << " ms for " << n_candidates << " frustum visible cubes ("
+              << best_test_ns / std::max<size_t>(n_candidates, 1) << " ns each), " << n_candidates - n_visible << " occluded" << std::endl;
+}
+
+void benchmark_mesh_allocator()
+{
+    const uint32_t ARENA_SIZE = 1 << 22; // vertices
+    const int N_OPS = 200000;
+
+    // mesh sizes like the scene's: mostly small LODs, now and then a large one, ~60% of the arena live
+    std::mt19937 rng(7);
+    std::vector<uint32_t> sizes(N_OPS);
+    for(uint32_t& size : sizes)
+        size = (rng() % 16 == 0) ? 4096 + rng() % 32768 : 24 + rng() % 1024;
+    std::vector<uint32_t> victims(N_OPS);
+    for(uint32_t& victim : victims)
+        victim = rng();
+
+    // same churn for both: allocate until 60% full, then free a random live range before every allocation
+    auto churn = [&](auto allocate, auto release, size_t& failures)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> live; // handle, size
+        uint64_t live_size = 0;
+        failures = 0;
+        for(int op = 0; op < N_OPS; op++)
+        {
+            while(live_size > ARENA_SIZE * 6ull / 10 && !live.empty())
+            {
+                size_t index = victims[op] % live.size();
+                live_size -= live[index].second;
+                release(live[index].first);
+                live[index] = live.back();
+                live.pop_back();
+            }
+            uint32_t handle;
+            if(allocate(sizes[op], handle))
+            {
+                live.push_back({ handle, sizes[op] });
+                live_size += sizes[op];
+            }
+            else
+            {
+                failures++;
+            }
+        }
+    };
+
+    OffsetAllocator tlsf(ARENA_SIZE);
+    std::vector<OffsetAllocator::Allocation> allocations;
+    size_t tlsf_failures;
+    auto start = Clock::now();
+    churn([&](uint32_t size, uint32_t& handle)
+    {
+        OffsetAllocator::Allocation allocation = tlsf.allocate(size);
+        if(!allocation.valid())
+            return false;
+        handle = (uint32_t)allocations.size();
+        allocations.push_back(allocation);
+        return true;
+    },
+    [&](uint32_t handle) { tlsf.free(allocations[handle]); }, tlsf_failures);
+    double tlsf_ns = elapsed_ns(start) / N_OPS;
+    OffsetAllocator::Stats stats = tlsf.stats();
+
+    // first fit over an address ordered free list, merging neighbours on free
+    std::map<uint32_t, uint32_t> free_blocks = { { 0, ARENA_SIZE } }; // offset -> size
+    std::vector<std::pair<uint32_t, uint32_t>> blocks;
+    size_t first_fit_failures;
+    start = Clock::now();
+    churn([&](uint32_t size, uint32_t& handle)
+    {
+        for(auto it = free_blocks.begin(); it != free_blocks.end(); ++it)
+        {
+            if(it->second < size)
+                continue;
+            uint32_t offset = it->first, rest = it->second - size;
+            free_blocks.erase(it);
+            if(rest)
+                free_blocks[offset + size] = rest;
+            handle = (uint32_t)blocks.size();
+            blocks.push_back({ offset, size });
+            return true;
+        }
+        return false;
+    },
+    [&](uint32_t handle)
+    {
+        uint32_t offset = blocks[handle].first, size = blocks[handle].second;
+        auto next = free_blocks.lower_bound(offset);
+        if(next != free_blocks.end() && next->first == offset + size)
+        {
+            size += next->second;
+            next = free_blocks.erase(next);
+        }
+        if(next != free_blocks.begin())
+        {
+            auto prev = std::prev(next);
+            if(prev->first + prev->second == offset)
+            {
+                prev->second += size;
+                return;
+            }
+        }
+        free_blocks[offset] = size;
+    }, first_fit_failures);
+    double first_fit_ns = elapsed_ns(start) / N_OPS;
+    uint32_t first_fit_largest = 0;
+    uint64_t first_fit_free = 0;
+    for(const auto& block : free_blocks)
+    {
+        first_fit_largest = std::max(first_fit_largest, block.second);
+        first_fit_free += block.second;
+    }
+
+    std::cout << "BENCHMARK::MESH_ALLOCATOR " << N_OPS << " allocations with churn in " << ARENA_SIZE << " vertices" << std::endl;
+    std::cout << "    TLSF: " << tlsf_ns << " ns per allocate + free, " << tlsf_failures << " failed, " << stats.free_blocks
+              << " free blocks, fragmentation " << 100.0f * stats.fragmentation() << "%" << std::endl;
+    std::cout << "    first fit: " << first_fit_ns << " ns per allocate + free, " << first_fit_failures << " failed, " << free_blocks.size()
+              << " free blocks, fragmentation " << 100.0 * (1.0 - (double)first_fit_largest / std::max<uint64_t>(first_fit_free, 1)) << "%" << std::endl;
+}
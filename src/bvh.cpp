@@ -0,0 +1,426 @@
+#include "Bvh.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    const int SAH_BINS = 16;
+    const uint32_t MAX_LEAF_SIZE = 8;
+    const float TRAVERSAL_COST = 1.0f;      // relative to one primitive test
+    const uint32_t MIN_PARALLEL_SIZE = 4096; // smaller subtrees are not worth a thread
+    const int MAX_SAH_DEPTH = 40;           // below this only median splits, which keeps the depth under the query stacks
+    const int STACK_SIZE = 128;
+
+    struct Box
+    {
+        glm::vec3 min = glm::vec3(FLT_MAX);
+        glm::vec3 max = glm::vec3(-FLT_MAX);
+
+        void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+        void grow(const glm::vec3& box_min, const glm::vec3& box_max) { min = glm::min(min, box_min); max = glm::max(max, box_max); }
+        void grow(const Box& box) { grow(box.min, box.max); }
+        float area() const
+        {
+            glm::vec3 size = max - min;
+            return (size.x < 0.0f) ? 0.0f : 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+    };
+
+    struct BuildNode
+    {
+        Box box;
+        uint32_t first;
+        uint32_t count;
+        uint32_t left; // children are left and left + 1, 0 for a leaf (the root is never anyone's child)
+    };
+
+    // partitioned in place, so every node's primitives stay contiguous in memory while splitting
+    struct BuildPrimitive
+    {
+        glm::vec3 min;
+        uint32_t index;
+        glm::vec3 max;
+        float pad;
+
+        glm::vec3 center() const { return 0.5f * (min + max); }
+    };
+
+    struct Builder
+    {
+        std::vector<BuildPrimitive> primitives;
+        std::vector<BuildNode> nodes;
+        std::atomic<uint32_t> used;
+
+        Builder() : used(0) {}
+
+        // binned SAH split of nodes[index] (median split when balanced); false leaves it a leaf
+        bool split(uint32_t index, bool balanced)
+        {
+            BuildNode& node = nodes[index];
+            if(node.count <= 2)
+                return false;
+
+            BuildPrimitive* begin = primitives.data() + node.first;
+            BuildPrimitive* end = begin + node.count;
+            Box centroid_box;
+            for(BuildPrimitive* primitive = begin; primitive != end; primitive++)
+                centroid_box.grow(primitive->center());
+            glm::vec3 extent = centroid_box.max - centroid_box.min;
+
+            float best_cost = FLT_MAX;
+            int best_axis = -1, best_bin = 0;
+            Box best_left, best_right;
+            for(int axis = 0; axis < 3 && !balanced; axis++)
+            {
+                if(extent[axis] <= 0.0f)
+                    continue;
+                Box boxes[SAH_BINS];
+                uint32_t counts[SAH_BINS] = {};
+                float scale = SAH_BINS / extent[axis];
+                for(BuildPrimitive* primitive = begin; primitive != end; primitive++)
+                {
+                    int bin = std::min((int)((primitive->center()[axis] - centroid_box.min[axis]) * scale), SAH_BINS - 1);
+                    boxes[bin].grow(primitive->min, primitive->max);
+                    counts[bin]++;
+                }
+                // sweep from the right for the right side boxes, then from the left evaluating each plane
+                Box right_box[SAH_BINS];
+                uint32_t right_count[SAH_BINS];
+                Box right;
+                uint32_t n_right = 0;
+                for(int bin = SAH_BINS - 1; bin > 0; bin--)
+                {
+                    right.grow(boxes[bin]);
+                    n_right += counts[bin];
+                    right_box[bin] = right;
+                    right_count[bin] = n_right;
+                }
+                Box left;
+                uint32_t n_left = 0;
+                for(int bin = 0; bin < SAH_BINS - 1; bin++)
+                {
+                    left.grow(boxes[bin]);
+                    n_left += counts[bin];
+                    if(n_left == 0 || right_count[bin + 1] == 0)
+                        continue;
+                    float cost = left.area() * n_left + right_box[bin + 1].area() * right_count[bin + 1];
+                    if(cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = bin;
+                        best_left = left;
+                        best_right = right_box[bin + 1];
+                    }
+                }
+            }
+
+            BuildPrimitive* middle;
+            BuildNode children[2];
+            float leaf_cost = node.box.area() * node.count;
+            if(best_axis >= 0 && TRAVERSAL_COST * node.box.area() + best_cost < leaf_cost)
+            {
+                float scale = SAH_BINS / extent[best_axis];
+                float lo = centroid_box.min[best_axis];
+                middle = std::partition(begin, end, [&](const BuildPrimitive& primitive)
+                {
+                    return std::min((int)((primitive.center()[best_axis] - lo) * scale), SAH_BINS - 1) <= best_bin;
+                });
+                children[0].box = best_left;
+                children[1].box = best_right;
+            }
+            else if((node.count > MAX_LEAF_SIZE || balanced) && (extent.x > 0.0f || extent.y > 0.0f || extent.z > 0.0f))
+            {
+                // SAH prefers a leaf but it would be too big: median split on the widest centroid axis
+                int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+                middle = begin + node.count / 2;
+                std::nth_element(begin, middle, end, [&](const BuildPrimitive& a, const BuildPrimitive& b) { return a.center()[axis] < b.center()[axis]; });
+                for(BuildPrimitive* primitive = begin; primitive != end; primitive++)
+                    children[primitive < middle ? 0 : 1].box.grow(primitive->min, primitive->max);
+            }
+            else
+                return false; // cheap enough, or every centroid is the same point
+
+            uint32_t left_count = (uint32_t)(middle - begin);
+            children[0].first = node.first;
+            children[0].count = left_count;
+            children[1].first = node.first + left_count;
+            children[1].count = node.count - left_count;
+            children[0].left = children[1].left = 0;
+            uint32_t left_index = used.fetch_add(2);
+            nodes[left_index] = children[0];
+            nodes[left_index + 1] = children[1];
+            node.left = left_index;
+            return true;
+        }
+
+        // splits down to the leaves, or stops at large subtrees up to max_depth and hands them out through frontier
+        void subdivide(uint32_t index, int depth, int max_depth, std::vector<uint32_t>* frontier)
+        {
+            if(frontier && depth >= max_depth && nodes[index].count >= MIN_PARALLEL_SIZE)
+            {
+                frontier->push_back(index);
+                return;
+            }
+            if(!split(index, depth >= MAX_SAH_DEPTH))
+                return;
+            uint32_t left = nodes[index].left;
+            subdivide(left, depth + 1, max_depth, frontier);
+            subdivide(left + 1, depth + 1, max_depth, frontier);
+        }
+    };
+
+    // nodes of the build tree in depth first order
+    void flatten(const std::vector<BuildNode>& build, uint32_t index, std::vector<BvhNode>& out)
+    {
+        const BuildNode& node = build[index];
+        uint32_t at = (uint32_t)out.size();
+        out.push_back({ node.box.min, node.first, node.box.max, node.count });
+        if(node.left)
+        {
+            out[at].count = 0;
+            flatten(build, node.left, out);
+            out[at].offset = (uint32_t)out.size();
+            flatten(build, node.left + 1, out);
+        }
+    }
+
+    // a subtree's primitives are contiguous: from its leftmost leaf's first to its rightmost leaf's last
+    void subtree_range(const std::vector<BvhNode>& nodes, uint32_t index, uint32_t& first, uint32_t& end)
+    {
+        uint32_t left = index;
+        while(nodes[left].count == 0)
+            left++;
+        uint32_t right = index;
+        while(nodes[right].count == 0)
+            right = nodes[right].offset;
+        first = nodes[left].offset;
+        end = nodes[right].offset + nodes[right].count;
+    }
+}
+
+void Bvh::build(const CullBounds& bounds)
+{
+    const uint32_t n = (uint32_t)bounds.size();
+    nodes.clear();
+    primitives.resize(n);
+    leaf_min.resize(n);
+    leaf_max.resize(n);
+    if(n == 0)
+        return;
+
+    Builder builder;
+    builder.primitives.resize(n);
+    for(uint32_t i = 0; i < n; i++)
+    {
+        glm::vec3 center(bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]);
+        glm::vec3 extent(bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i]);
+        builder.primitives[i] = { center - extent, i, center + extent, 0.0f };
+    }
+
+    // a binary tree over n leaves of at least one primitive has at most 2n - 1 nodes
+    builder.nodes.resize(2 * (size_t)n);
+    BuildNode& root = builder.nodes[0];
+    root.first = 0;
+    root.count = n;
+    root.left = 0;
+    for(const BuildPrimitive& primitive : builder.primitives)
+        root.box.grow(primitive.min, primitive.max);
+    builder.used = 1;
+
+    // serial top levels until there are about four subtrees per thread, then those in parallel
+    std::vector<uint32_t> frontier;
+    int max_depth = (int)std::ceil(std::log2((double)worker_count())) + 2;
+    builder.subdivide(0, 0, max_depth, worker_count() > 1 ? &frontier : nullptr);
+    parallel_for(0, frontier.size(), [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++)
+            builder.subdivide(frontier[i], max_depth, 0, nullptr);
+    });
+
+    nodes.reserve(builder.used);
+    flatten(builder.nodes, 0, nodes);
+    for(uint32_t i = 0; i < n; i++)
+    {
+        primitives[i] = builder.primitives[i].index;
+        leaf_min[i] = builder.primitives[i].min;
+        leaf_max[i] = builder.primitives[i].max;
+    }
+}
+
+void Bvh::refit(const CullBounds& bounds)
+{
+    for(size_t i = 0; i < primitives.size(); i++)
+    {
+        uint32_t object = primitives[i];
+        glm::vec3 center(bounds.center_x[object], bounds.center_y[object], bounds.center_z[object]);
+        glm::vec3 extent(bounds.extent_x[object], bounds.extent_y[object], bounds.extent_z[object]);
+        leaf_min[i] = center - extent;
+        leaf_max[i] = center + extent;
+    }
+    // children always come after their parent, so one backwards sweep is bottom up
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        BvhNode& node = nodes[i];
+        Box box;
+        if(node.count)
+        {
+            for(uint32_t p = node.offset; p < node.offset + node.count; p++)
+                box.grow(leaf_min[p], leaf_max[p]);
+        }
+        else
+        {
+            box.grow(nodes[i + 1].min, nodes[i + 1].max);
+            box.grow(nodes[node.offset].min, nodes[node.offset].max);
+        }
+        node.min = box.min;
+        node.max = box.max;
+    }
+}
+
+size_t Bvh::cull(const Frustum& frustum, uint32_t* visible) const
+{
+    if(nodes.empty())
+        return 0;
+
+    // per node: which planes still need testing, a bit each
+    auto classify = [&](const glm::vec3& min, const glm::vec3& max, unsigned int& mask)
+    {
+        glm::vec3 center = 0.5f * (min + max);
+        glm::vec3 extent = 0.5f * (max - min);
+        for(int p = 0; p < 6; p++)
+        {
+            if(!(mask & (1u << p)))
+                continue;
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            float reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if(distance + reach < 0.0f)
+                return false;
+            if(distance - reach >= 0.0f)
+                mask &= ~(1u << p); // everything below is inside this plane
+        }
+        return true;
+    };
+
+    struct Entry { uint32_t node; unsigned int mask; };
+    Entry stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = { 0, 0x3F };
+    size_t count = 0;
+    while(top > 0)
+    {
+        Entry entry = stack[--top];
+        const BvhNode& node = nodes[entry.node];
+        unsigned int mask = entry.mask;
+        if(!classify(node.min, node.max, mask))
+            continue;
+        if(mask == 0)
+        {
+            // fully inside: the whole subtree, no more tests
+            uint32_t first, end;
+            subtree_range(nodes, entry.node, first, end);
+            for(uint32_t p = first; p < end; p++)
+                visible[count++] = primitives[p];
+            continue;
+        }
+        if(node.count)
+        {
+            for(uint32_t p = node.offset; p < node.offset + node.count; p++)
+            {
+                unsigned int primitive_mask = mask;
+                if(classify(leaf_min[p], leaf_max[p], primitive_mask))
+                    visible[count++] = primitives[p];
+            }
+            continue;
+        }
+        // right first so the left subtree is output first, keeping the output in tree order
+        stack[top++] = { node.offset, mask };
+        stack[top++] = { entry.node + 1, mask };
+    }
+    return count;
+}
+
+bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_t, BvhHit& hit) const
+{
+    if(nodes.empty())
+        return false;
+    glm::vec3 inverse = 1.0f / direction; // +-inf for axis parallel rays, the slab test copes
+    // entry distance of the ray into a box, or FLT_MAX on a miss / beyond limit
+    auto enter = [&](const glm::vec3& min, const glm::vec3& max, float limit)
+    {
+        glm::vec3 t0 = (min - origin) * inverse;
+        glm::vec3 t1 = (max - origin) * inverse;
+        glm::vec3 near_t = glm::min(t0, t1), far_t = glm::max(t0, t1);
+        float t_enter = std::max(std::max(near_t.x, near_t.y), std::max(near_t.z, 0.0f));
+        float t_exit = std::min(std::min(far_t.x, far_t.y), std::min(far_t.z, limit));
+        return t_enter <= t_exit ? t_enter : FLT_MAX;
+    };
+
+    float best = max_t;
+    bool found = false;
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    if(enter(nodes[0].min, nodes[0].max, best) != FLT_MAX)
+        stack[top++] = 0;
+    while(top > 0)
+    {
+        const BvhNode& node = nodes[stack[--top]];
+        if(enter(node.min, node.max, best) == FLT_MAX) // the best hit got closer since this was pushed
+            continue;
+        if(node.count)
+        {
+            for(uint32_t p = node.offset; p < node.offset + node.count; p++)
+            {
+                float t = enter(leaf_min[p], leaf_max[p], best);
+                if(t != FLT_MAX && (t < best || !found))
+                {
+                    best = t;
+                    hit.object = primitives[p];
+                    hit.t = t;
+                    found = true;
+                }
+            }
+            continue;
+        }
+        // nearer child on top of the stack
+        uint32_t left = (uint32_t)(&node - nodes.data()) + 1, right = node.offset;
+        float t_left = enter(nodes[left].min, nodes[left].max, best);
+        float t_right = enter(nodes[right].min, nodes[right].max, best);
+        if(t_left > t_right)
+        {
+            std::swap(left, right);
+            std::swap(t_left, t_right);
+        }
+        if(t_right != FLT_MAX)
+            stack[top++] = right;
+        if(t_left != FLT_MAX)
+            stack[top++] = left;
+    }
+    return found;
+}
+
+size_t Bvh::depth() const
+{
+    if(nodes.empty())
+        return 0;
+    size_t deepest = 0;
+    struct Entry { uint32_t node; size_t depth; };
+    std::vector<Entry> stack = { { 0, 1 } };
+    while(!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        deepest = std::max(deepest, entry.depth);
+        const BvhNode& node = nodes[entry.node];
+        if(node.count == 0)
+        {
+            stack.push_back({ entry.node + 1, entry.depth + 1 });
+            stack.push_back({ node.offset, entry.depth + 1 });
+        }
+    }
+    return deepest;
+}
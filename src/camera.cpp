@@ -25,6 +25,11 @@ glm::mat4 Camera::get_view_matrix() const
     return glm::lookAt(position, position + front, up);
 }
 
+Frustum Camera::get_frustum(const glm::mat4& projection) const
+{
+    return Frustum::from_matrix(projection * get_view_matrix());
+}
+
 void Camera::process_keyboard_input(Camera_Movement direction, float delta_time)
 {
     float velocity = movement_speed * delta_time;
@@ -0,0 +1,22 @@
+#include "CameraUniforms.hpp"
+
+CameraUniforms::CameraUniforms()
+{
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ID);
+}
+
+void CameraUniforms::update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position)
+{
+    CameraBlock block = { projection, view, glm::vec4(position, 1.0f) };
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW); // orphan last frame's copy
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+}
+
+void CameraUniforms::destroy()
+{
+    glDeleteBuffers(1, &ID);
+}
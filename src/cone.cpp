@@ -0,0 +1,124 @@
+#include "Cone.hpp"
+#include <cmath>
+#include <algorithm>
+
+#ifndef M_PI 	// manually defined pi constant for use in calculations
+#define M_PI 3.14159265358979323846
+#endif
+
+const MeshData& Cone::get(int nSectors, int nStacks)
+{
+    static std::map<std::pair<int, int>, MeshData> cache;
+
+    nSectors = std::max(nSectors, MIN_SECTORS);
+    nStacks = std::max(nStacks, 1);
+    auto key = std::make_pair(nSectors, nStacks);
+    auto it = cache.find(key);
+    if(it == cache.end())
+        it = cache.emplace(key, build_vertices_smooth(nSectors, nStacks)).first;
+    return it->second;
+}
+
+std::vector<const MeshData*> Cone::get_lod_chain(int nSectors, int nStacks, int nLevels)
+{
+    std::vector<const MeshData*> chain;
+    chain.reserve(nLevels);
+    for(int level = 0; level < nLevels; level++)
+    {
+        chain.push_back(&get(nSectors, nStacks));
+        nSectors = std::max(nSectors / 2, MIN_SECTORS);
+    }
+    return chain;
+}
+
+MeshData Cone::build_vertices_smooth(int nSectors, int nStacks)
+{
+    const std::vector<glm::vec2>& circle = get_unit_circle_vertices(nSectors);
+
+    // side normal of a cone with radius r and height h at angle a is (h cos a, r, -h sin a), normalized.
+    // Unit cone: r = h = 1
+    const float invLength = 1.0f / std::sqrt(2.0f);
+
+    MeshData cone;
+    // sides: nStacks + 1 rings of nSectors + 1 (the seam is duplicated for its uv), base: center + ring
+    cone.vertices.resize((nStacks + 1) * (nSectors + 1) + 1 + nSectors);
+    // sides: every band is a quad strip except the apex band, which is one triangle per sector
+    cone.indices.resize(3 * nSectors * (2 * nStacks - 1) + 3 * nSectors);
+
+    Vertex* vertex = cone.vertices.data();
+    for(int i = 0; i <= nStacks; i++)
+    {
+        float t = (float)i / nStacks;
+        float radius = 1.0f - t;
+        float y = t - 0.5f;
+        for(int j = 0; j <= nSectors; j++, vertex++)
+        {
+            glm::vec2 c = circle[j % nSectors];
+            vertex->position = glm::vec3(radius * c.x, y, radius * c.y);
+            vertex->normal = glm::vec3(c.x, 1.0f, c.y) * invLength;
+            vertex->tex_coords = glm::vec2((float)j / nSectors, t);
+        }
+    }
+    // base, facing down
+    uint32_t baseCenter = (uint32_t)(vertex - cone.vertices.data());
+    *vertex++ = { glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.5f) };
+    for(int j = 0; j < nSectors; j++, vertex++)
+        *vertex = { glm::vec3(circle[j].x, -0.5f, circle[j].y), glm::vec3(0.0f, -1.0f, 0.0f), 0.5f + 0.5f * circle[j] };
+
+    uint32_t* index = cone.indices.data();
+    for(int i = 0; i < nStacks; i++)
+    {
+        uint32_t k1 = i * (nSectors + 1);
+        uint32_t k2 = k1 + nSectors + 1;
+        for(int j = 0; j < nSectors; j++, k1++, k2++)
+        {
+            *index++ = k1;  *index++ = k1 + 1;  *index++ = k2;
+            if(i != nStacks - 1) // the top ring collapses into the apex
+            {
+                *index++ = k2;  *index++ = k1 + 1;  *index++ = k2 + 1;
+            }
+        }
+    }
+    for(int j = 0; j < nSectors; j++)
+    {
+        *index++ = baseCenter;
+        *index++ = baseCenter + 1 + (j + 1) % nSectors;
+        *index++ = baseCenter + 1 + j;
+    }
+
+    MeshBuilder builder;
+    builder.reserve(cone.vertices.size(), cone.indices.size());
+    builder.add_indexed(cone);
+    return builder.build();
+}
+
+glm::mat4 Cone::get_model_matrix(glm::vec3 position, float radius, float height, glm::vec3 upDir)
+{
+    glm::vec3 up = glm::normalize(upDir);
+    // any axis not parallel to up works to build the basis
+    glm::vec3 helper = std::abs(up.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 right = glm::normalize(glm::cross(helper, up));
+    glm::vec3 forward = glm::cross(right, up);
+
+    glm::mat4 model(1.0f);
+    model[0] = glm::vec4(right * radius, 0.0f);
+    model[1] = glm::vec4(up * height, 0.0f);
+    model[2] = glm::vec4(forward * radius, 0.0f);
+    model[3] = glm::vec4(position + 0.5f * height * up, 1.0f); // unit cone's base sits at y = -0.5
+    return model;
+}
+
+const std::vector<glm::vec2>& Cone::get_unit_circle_vertices(int nSectors)
+{
+    static std::map<int, std::vector<glm::vec2>> cache;
+
+    auto it = cache.find(nSectors);
+    if(it != cache.end())
+        return it->second;
+
+    std::vector<glm::vec2> circle(nSectors);
+    const double sectorStep = 2.0 * M_PI / nSectors;
+    for(int j = 0; j < nSectors; j++)
+        circle[j] = glm::vec2((float)std::cos(j * sectorStep), (float)-std::sin(j * sectorStep));
+    return cache.emplace(nSectors, std::move(circle)).first->second;
+}
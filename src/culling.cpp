@@ -0,0 +1,170 @@
+#include "Culling.hpp"
+#include <emmintrin.h>
+#include <cmath>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+void CullBounds::clear()
+{
+    center_x.clear(); center_y.clear(); center_z.clear();
+    extent_x.clear(); extent_y.clear(); extent_z.clear();
+    radius.clear();
+}
+
+void CullBounds::reserve(size_t count)
+{
+    center_x.reserve(count); center_y.reserve(count); center_z.reserve(count);
+    extent_x.reserve(count); extent_y.reserve(count); extent_z.reserve(count);
+    radius.reserve(count);
+}
+
+void CullBounds::add_sphere(const glm::vec3& center, float sphere_radius)
+{
+    center_x.push_back(center.x); center_y.push_back(center.y); center_z.push_back(center.z);
+    extent_x.push_back(sphere_radius); extent_y.push_back(sphere_radius); extent_z.push_back(sphere_radius);
+    radius.push_back(sphere_radius);
+}
+
+void CullBounds::add_aabb(const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 center = 0.5f * (min + max);
+    glm::vec3 extent = 0.5f * (max - min);
+    center_x.push_back(center.x); center_y.push_back(center.y); center_z.push_back(center.z);
+    extent_x.push_back(extent.x); extent_y.push_back(extent.y); extent_z.push_back(extent.z);
+    radius.push_back(glm::length(extent));
+}
+
+void CullBounds::add_transformed_aabb(const glm::vec3& local_min, const glm::vec3& local_max, const glm::mat4& model)
+{
+    // Arvo: the world extent along each axis is the local extent through the absolute rotation / scale part
+    glm::vec3 local_center = 0.5f * (local_min + local_max);
+    glm::vec3 local_extent = 0.5f * (local_max - local_min);
+    glm::vec3 center = glm::vec3(model * glm::vec4(local_center, 1.0f));
+    glm::mat3 linear(model);
+    glm::vec3 extent(0.0f);
+    for(int column = 0; column < 3; column++)
+        extent += glm::abs(linear[column]) * local_extent[column];
+    add_aabb(center - extent, center + extent);
+}
+
+namespace
+{
+    // plane components splatted once per call
+    struct SplatPlanes
+    {
+        __m128 x[6], y[6], z[6], w[6], abs_x[6], abs_y[6], abs_z[6];
+
+        explicit SplatPlanes(const Frustum& frustum)
+        {
+            for(int p = 0; p < 6; p++)
+            {
+                const glm::vec4& plane = frustum.planes[p];
+                x[p] = _mm_set1_ps(plane.x); y[p] = _mm_set1_ps(plane.y); z[p] = _mm_set1_ps(plane.z); w[p] = _mm_set1_ps(plane.w);
+                abs_x[p] = _mm_set1_ps(std::abs(plane.x)); abs_y[p] = _mm_set1_ps(std::abs(plane.y)); abs_z[p] = _mm_set1_ps(std::abs(plane.z));
+            }
+        }
+    };
+
+    // appends base + bit for every set bit of mask
+    inline size_t write_visible(int mask, uint32_t base, uint32_t* visible, size_t count)
+    {
+        while(mask)
+        {
+            visible[count++] = base + (uint32_t)__builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+        return count;
+    }
+
+#ifdef __AVX__
+    struct SplatPlanes8
+    {
+        __m256 x[6], y[6], z[6], w[6], abs_x[6], abs_y[6], abs_z[6];
+
+        explicit SplatPlanes8(const Frustum& frustum)
+        {
+            for(int p = 0; p < 6; p++)
+            {
+                const glm::vec4& plane = frustum.planes[p];
+                x[p] = _mm256_set1_ps(plane.x); y[p] = _mm256_set1_ps(plane.y); z[p] = _mm256_set1_ps(plane.z); w[p] = _mm256_set1_ps(plane.w);
+                abs_x[p] = _mm256_set1_ps(std::abs(plane.x)); abs_y[p] = _mm256_set1_ps(std::abs(plane.y)); abs_z[p] = _mm256_set1_ps(std::abs(plane.z));
+            }
+        }
+    };
+#endif
+
+    // shared loop: objects are visible when, for every plane, distance(center) + reach >= 0.
+    // reach is the radius for spheres and the box's projected half size for AABBs.
+    template<bool BOXES>
+    size_t cull(const Frustum& frustum, const CullBounds& bounds, uint32_t* visible)
+    {
+        const size_t n = bounds.size();
+        const float* cx = bounds.center_x.data();
+        const float* cy = bounds.center_y.data();
+        const float* cz = bounds.center_z.data();
+        const float* ex = bounds.extent_x.data();
+        const float* ey = bounds.extent_y.data();
+        const float* ez = bounds.extent_z.data();
+        const float* r = bounds.radius.data();
+        size_t count = 0;
+        size_t i = 0;
+
+#ifdef __AVX__
+        SplatPlanes8 planes8(frustum);
+        for(; i + 8 <= n; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for(int p = 0; p < 6; p++)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes8.x[p], x), _mm256_mul_ps(planes8.y[p], y)),
+                                                _mm256_add_ps(_mm256_mul_ps(planes8.z[p], z), planes8.w[p]));
+                __m256 reach = BOXES
+                    ? _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes8.abs_x[p], _mm256_loadu_ps(ex + i)), _mm256_mul_ps(planes8.abs_y[p], _mm256_loadu_ps(ey + i))),
+                                    _mm256_mul_ps(planes8.abs_z[p], _mm256_loadu_ps(ez + i)))
+                    : _mm256_loadu_ps(r + i);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            count = write_visible(_mm256_movemask_ps(inside), (uint32_t)i, visible, count);
+        }
+#endif
+
+        SplatPlanes planes(frustum);
+        for(; i + 4 <= n; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for(int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.x[p], x), _mm_mul_ps(planes.y[p], y)),
+                                             _mm_add_ps(_mm_mul_ps(planes.z[p], z), planes.w[p]));
+                __m128 reach = BOXES
+                    ? _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.abs_x[p], _mm_loadu_ps(ex + i)), _mm_mul_ps(planes.abs_y[p], _mm_loadu_ps(ey + i))),
+                                 _mm_mul_ps(planes.abs_z[p], _mm_loadu_ps(ez + i)))
+                    : _mm_loadu_ps(r + i);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+            }
+            count = write_visible(_mm_movemask_ps(inside), (uint32_t)i, visible, count);
+        }
+
+        for(; i < n; i++)
+        {
+            glm::vec3 center(cx[i], cy[i], cz[i]);
+            bool inside = BOXES ? frustum.intersects_aabb(center, glm::vec3(ex[i], ey[i], ez[i])) : frustum.intersects_sphere(center, r[i]);
+            if(inside)
+                visible[count++] = (uint32_t)i;
+        }
+        return count;
+    }
+}
+
+size_t cull_spheres(const Frustum& frustum, const CullBounds& bounds, uint32_t* visible)
+{
+    return cull<false>(frustum, bounds, visible);
+}
+
+size_t cull_aabbs(const Frustum& frustum, const CullBounds& bounds, uint32_t* visible)
+{
+    return cull<true>(frustum, bounds, visible);
+}
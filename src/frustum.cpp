@@ -0,0 +1,43 @@
+#include "Frustum.hpp"
+
+Frustum Frustum::from_matrix(const glm::mat4& m)
+{
+    // Gribb / Hartmann: each plane is the fourth row of the matrix plus or minus one of the others (glm is column major)
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[PLANE_LEFT] = row3 + row0;
+    frustum.planes[PLANE_RIGHT] = row3 - row0;
+    frustum.planes[PLANE_BOTTOM] = row3 + row1;
+    frustum.planes[PLANE_TOP] = row3 - row1;
+    frustum.planes[PLANE_NEAR] = row3 + row2;
+    frustum.planes[PLANE_FAR] = row3 - row2;
+    for(glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects_sphere(const glm::vec3& center, float radius) const
+{
+    for(const glm::vec4& plane : planes)
+    {
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects_aabb(const glm::vec3& center, const glm::vec3& extent) const
+{
+    for(const glm::vec4& plane : planes)
+    {
+        // the box corner furthest along the plane normal decides
+        glm::vec3 normal(plane);
+        if(glm::dot(normal, center) + glm::dot(glm::abs(normal), extent) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+#include "GBuffer.hpp"
+#include "GLState.hpp"
+#include <iostream>
+
+GBuffer::GBuffer(int width, int height)
+    : width(width), height(height)
+{
+    glGenFramebuffers(1, &ID);
+    unsigned int textures[4];
+    glGenTextures(4, textures);
+    albedo = textures[0];
+    specular = textures[1];
+    normal = textures[2];
+    depth = textures[3];
+    glGenVertexArrays(1, &fullscreen_vao);
+    allocate();
+}
+
+void GBuffer::allocate()
+{
+    struct Target { unsigned int texture; GLenum internal_format, format, type, attachment; };
+    const Target targets[4] =
+    {
+        { albedo, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0 },
+        { specular, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1 },
+        { normal, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT2 },
+        { depth, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT },
+    };
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ID);
+    for(const Target& target : targets)
+    {
+        // read with texelFetch only, so no filtering or mips
+        gl_state().bind_texture(GL_TEXTURE_2D, target.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, target.internal_format, width, height, 0, target.format, target.type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, target.attachment, GL_TEXTURE_2D, target.texture, 0);
+    }
+    const GLenum draw_buffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, draw_buffers);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::resize(int width, int height)
+{
+    if(width == this->width && height == this->height)
+        return;
+    if(width <= 0 || height <= 0) // minimized
+        return;
+    this->width = width;
+    this->height = height;
+    allocate();
+}
+
+void GBuffer::begin_geometry()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, ID);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GBuffer::light(Shader& lighting_shader)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    const unsigned int textures[4] = { albedo, specular, normal, depth };
+    for(GLuint i = 0; i < 4; i++)
+        gl_state().bind_texture_unit(GBUFFER_TEXTURE_UNIT + i, GL_TEXTURE_2D, textures[i]);
+
+    // every pixel is shaded exactly once, whatever the overdraw in the geometry pass was
+    glDisable(GL_DEPTH_TEST);
+    lighting_shader.use();
+    gl_state().bind_vertex_array(fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glEnable(GL_DEPTH_TEST);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::destroy()
+{
+    const unsigned int textures[4] = { albedo, specular, normal, depth };
+    for(unsigned int texture : textures)
+        gl_state().forget_texture(texture);
+    glDeleteTextures(4, textures);
+    gl_state().forget_vertex_array(fullscreen_vao);
+    glDeleteVertexArrays(1, &fullscreen_vao);
+    glDeleteFramebuffers(1, &ID);
+}
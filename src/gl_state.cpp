@@ -0,0 +1,123 @@
+#include "GLState.hpp"
+
+GLStateCache& gl_state()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+GLStateCache::GLStateCache()
+    : issued_last_frame(0), dropped_last_frame(0), issued(0), dropped(0)
+{
+    invalidate();
+}
+
+bool GLStateCache::changed(GLuint& current, GLuint wanted)
+{
+    if(current == wanted)
+    {
+        dropped++;
+        return false;
+    }
+    current = wanted;
+    issued++;
+    return true;
+}
+
+void GLStateCache::use_program(GLuint wanted)
+{
+    if(changed(program, wanted))
+        glUseProgram(wanted);
+}
+
+void GLStateCache::bind_vertex_array(GLuint wanted)
+{
+    if(changed(vao, wanted))
+        glBindVertexArray(wanted);
+}
+
+void GLStateCache::active_texture(GLenum unit)
+{
+    if(changed(active_unit, unit))
+        glActiveTexture(unit);
+}
+
+void GLStateCache::bind_texture(GLenum target, GLuint texture)
+{
+    int slot = target_slot(target);
+    GLuint unit = active_unit - GL_TEXTURE0;
+    if(slot < 0 || unit >= (GLuint)MAX_TEXTURE_UNITS) // not tracked, always issue
+    {
+        issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if(changed(textures[unit][slot], texture))
+        glBindTexture(target, texture);
+}
+
+void GLStateCache::bind_texture_unit(GLuint unit, GLenum target, GLuint texture)
+{
+    int slot = target_slot(target);
+    if(slot >= 0 && unit < (GLuint)MAX_TEXTURE_UNITS && textures[unit][slot] == texture)
+    {
+        dropped++; // already bound there, no need to even switch units
+        return;
+    }
+    active_texture(GL_TEXTURE0 + unit);
+    bind_texture(target, texture);
+}
+
+void GLStateCache::polygon_mode(GLenum mode)
+{
+    if(changed(polygon, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLStateCache::forget_program(GLuint deleted)
+{
+    if(program == deleted)
+        program = UNKNOWN;
+}
+
+void GLStateCache::forget_vertex_array(GLuint deleted)
+{
+    if(vao == deleted)
+        vao = 0; // deleting the bound VAO reverts the binding to 0
+}
+
+void GLStateCache::forget_texture(GLuint deleted)
+{
+    for(int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+        for(int slot = 0; slot < N_TARGET_SLOTS; slot++)
+            if(textures[unit][slot] == deleted)
+                textures[unit][slot] = 0;
+}
+
+void GLStateCache::invalidate()
+{
+    program = vao = active_unit = polygon = UNKNOWN;
+    for(int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+        for(int slot = 0; slot < N_TARGET_SLOTS; slot++)
+            textures[unit][slot] = UNKNOWN;
+}
+
+void GLStateCache::begin_frame()
+{
+    issued_last_frame = issued;
+    dropped_last_frame = dropped;
+    issued = dropped = 0;
+}
+
+int GLStateCache::target_slot(GLenum target)
+{
+    switch(target)
+    {
+        case GL_TEXTURE_2D:         return SLOT_2D;
+        case GL_TEXTURE_2D_ARRAY:   return SLOT_2D_ARRAY;
+        case GL_TEXTURE_CUBE_MAP:   return SLOT_CUBE_MAP;
+        case GL_TEXTURE_3D:         return SLOT_3D;
+        case GL_TEXTURE_BUFFER:     return SLOT_BUFFER;
+        default:                    return -1;
+    }
+}
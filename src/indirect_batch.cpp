@@ -0,0 +1,130 @@
+#include "IndirectBatch.hpp"
+#include "GLState.hpp"
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // not in the GL 3.3 headers
+    const GLenum DRAW_INDIRECT_BUFFER = 0x8F3F;
+
+    typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+    MultiDrawElementsIndirectProc multi_draw_elements_indirect = nullptr;
+
+    bool has_extension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(GLint i = 0; i < count; i++)
+            if(strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+                return true;
+        return false;
+    }
+}
+
+bool load_multi_draw_indirect(GLADloadproc load)
+{
+    multi_draw_elements_indirect = nullptr;
+    bool core = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+    // base_instance has to be honoured too, it is how each command finds its instances
+    if(core || (has_extension("GL_ARB_multi_draw_indirect") && has_extension("GL_ARB_base_instance")))
+    {
+        multi_draw_elements_indirect = (MultiDrawElementsIndirectProc)load("glMultiDrawElementsIndirect");
+        if(!multi_draw_elements_indirect)
+            std::cout << "ERROR::INDIRECT_BATCH::glMultiDrawElementsIndirect advertised but not loadable" << std::endl;
+    }
+    return multi_draw_elements_indirect != nullptr;
+}
+
+bool multi_draw_indirect_supported()
+{
+    return multi_draw_elements_indirect != nullptr;
+}
+
+IndirectBatch::IndirectBatch(const MeshArena& arena)
+    : use_multi_draw(true), draw_calls(0), vao(arena.vao(FORMAT_LIT)), capacity(0)
+{
+    glGenBuffers(1, &ID);
+    // non-instanced draws from the arena VAO still fetch instance 0, keep it backed before the first upload
+    InstanceData placeholder;
+    instances.upload(&placeholder, 1);
+    instances.attach(vao, 3);
+}
+
+void IndirectBatch::clear()
+{
+    commands.clear();
+    instance_data.clear();
+}
+
+void IndirectBatch::add(const MeshRange& mesh, const InstanceData* data, size_t count)
+{
+    if(count == 0)
+        return;
+    DrawElementsIndirectCommand* last = commands.empty() ? nullptr : &commands.back();
+    if(last && last->first_index == mesh.first_index && last->count == mesh.index_count && last->base_vertex == mesh.base_vertex)
+    {
+        last->instance_count += (uint32_t)count; // its instances end where these start
+    }
+    else
+    {
+        DrawElementsIndirectCommand command;
+        command.count = mesh.index_count;
+        command.instance_count = (uint32_t)count;
+        command.first_index = mesh.first_index;
+        command.base_vertex = mesh.base_vertex;
+        command.base_instance = (uint32_t)instance_data.size();
+        commands.push_back(command);
+    }
+    instance_data.insert(instance_data.end(), data, data + count);
+}
+
+void IndirectBatch::upload()
+{
+    instances.upload(instance_data.data(), instance_data.size());
+    if(!multi_draw_indirect_supported())
+        return; // the fallback reads the commands from memory
+
+    glBindBuffer(DRAW_INDIRECT_BUFFER, ID);
+    if(commands.size() > capacity)
+        capacity = (commands.size() > capacity * 2) ? commands.size() : capacity * 2;
+    glBufferData(DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW); // (re)allocate or orphan
+    if(!commands.empty())
+        glBufferSubData(DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+}
+
+void IndirectBatch::draw(GLenum mode)
+{
+    draw_calls = 0;
+    if(commands.empty())
+        return;
+
+    if(use_multi_draw && multi_draw_indirect_supported())
+    {
+        gl_state().bind_vertex_array(vao);
+        glBindBuffer(DRAW_INDIRECT_BUFFER, ID);
+        multi_draw_elements_indirect(mode, MeshArena::index_type, (void*)0, (GLsizei)commands.size(), 0);
+        draw_calls = 1;
+        return;
+    }
+
+    // no base instance before GL 4.2: move the instance attributes to each command's first instance instead
+    for(const DrawElementsIndirectCommand& command : commands)
+    {
+        instances.attach(vao, 3, command.base_instance);
+        gl_state().bind_vertex_array(vao);
+        glDrawElementsInstancedBaseVertex(mode, (GLsizei)command.count, MeshArena::index_type,
+                                          (void*)(command.first_index * sizeof(uint32_t)), (GLsizei)command.instance_count, command.base_vertex);
+        draw_calls++;
+    }
+    instances.attach(vao, 3);
+}
+
+void IndirectBatch::destroy()
+{
+    glDeleteBuffers(1, &ID);
+    instances.destroy();
+    ID = 0;
+    capacity = 0;
+    clear();
+}
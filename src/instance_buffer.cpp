@@ -0,0 +1,51 @@
+#include "InstanceBuffer.hpp"
+#include "GLState.hpp"
+
+InstanceBuffer::InstanceBuffer()
+    : capacity(0), count(0)
+{
+    glGenBuffers(1, &ID);
+}
+
+void InstanceBuffer::attach(unsigned int vao, unsigned int first_location, size_t first_instance) const
+{
+    gl_state().bind_vertex_array(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, ID);
+    const size_t base = first_instance * sizeof(InstanceData);
+    // a mat4 attribute takes 4 consecutive vec4 locations
+    for(unsigned int column = 0; column < 4; column++)
+    {
+        unsigned int model_loc = first_location + column;
+        glVertexAttribPointer(model_loc, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(model_loc);
+        glVertexAttribDivisor(model_loc, 1);
+
+        unsigned int normal_loc = first_location + 4 + column;
+        glVertexAttribPointer(normal_loc, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, normalMat) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(normal_loc);
+        glVertexAttribDivisor(normal_loc, 1);
+    }
+    unsigned int layer_loc = first_location + 8;
+    glVertexAttribIPointer(layer_loc, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, layer)));
+    glEnableVertexAttribArray(layer_loc);
+    glVertexAttribDivisor(layer_loc, 1);
+    gl_state().bind_vertex_array(0);
+}
+
+void InstanceBuffer::upload(const InstanceData* instances, size_t new_count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, ID);
+    if(new_count > capacity)
+        capacity = (new_count > capacity * 2) ? new_count : capacity * 2;
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW); // (re)allocate or orphan
+    if(new_count > 0)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, new_count * sizeof(InstanceData), instances);
+    count = new_count;
+}
+
+void InstanceBuffer::destroy()
+{
+    glDeleteBuffers(1, &ID);
+    ID = 0;
+    capacity = count = 0;
+}
@@ -0,0 +1,243 @@
+#include "LightClusters.hpp"
+#include "CameraUniforms.hpp"
+#include "GLState.hpp"
+#include "Parallel.hpp"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+ClusterGrid::ClusterGrid()
+    : global_count(0), clusters(CLUSTER_COUNT), max_indices(SIZE_MAX), dropped(0),
+      fov_y(0.0f), aspect(0.0f), z_near(0.0f), z_far(0.0f), scale(0.0f), bias(0.0f),
+      min_x(CLUSTER_COUNT), min_y(CLUSTER_COUNT), min_z(CLUSTER_COUNT), max_x(CLUSTER_COUNT), max_y(CLUSTER_COUNT), max_z(CLUSTER_COUNT),
+      row_min_y(CLUSTER_Y * CLUSTER_Z), row_max_y(CLUSTER_Y * CLUSTER_Z),
+      slice_indices(CLUSTER_Z), slice_pairs(CLUSTER_Z)
+{
+}
+
+void ClusterGrid::set_projection(float fov_y_degrees, float aspect, float z_near, float z_far)
+{
+    if(fov_y_degrees == fov_y && aspect == this->aspect && z_near == this->z_near && z_far == this->z_far)
+        return;
+    fov_y = fov_y_degrees;
+    this->aspect = aspect;
+    this->z_near = z_near;
+    this->z_far = z_far;
+
+    // slice k spans near * (far / near)^(k / Z) .. near * (far / near)^((k + 1) / Z), so the shader finds it with one log
+    float log_ratio = std::log(z_far / z_near);
+    scale = CLUSTER_Z / log_ratio;
+    bias = -CLUSTER_Z * std::log(z_near) / log_ratio;
+
+    float tan_half_y = std::tan(glm::radians(fov_y_degrees) * 0.5f);
+    float tan_half_x = tan_half_y * aspect;
+    for(int z = 0; z < CLUSTER_Z; z++)
+    {
+        float near_depth = z_near * std::pow(z_far / z_near, (float)z / CLUSTER_Z);
+        float far_depth = z_near * std::pow(z_far / z_near, (float)(z + 1) / CLUSTER_Z);
+        for(int y = 0; y < CLUSTER_Y; y++)
+        {
+            // tile y = 0 is the bottom row, like gl_FragCoord
+            float ndc_y0 = -1.0f + 2.0f * y / CLUSTER_Y, ndc_y1 = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+            int row = z * CLUSTER_Y + y;
+            row_min_y[row] = std::min(ndc_y0 * near_depth, ndc_y0 * far_depth) * tan_half_y;
+            row_max_y[row] = std::max(ndc_y1 * near_depth, ndc_y1 * far_depth) * tan_half_y;
+            for(int x = 0; x < CLUSTER_X; x++)
+            {
+                float ndc_x0 = -1.0f + 2.0f * x / CLUSTER_X, ndc_x1 = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+                int cluster = row * CLUSTER_X + x;
+                // the tile's frustum slab is bounded by its four corner rays at both depths
+                min_x[cluster] = std::min(ndc_x0 * near_depth, ndc_x0 * far_depth) * tan_half_x;
+                max_x[cluster] = std::max(ndc_x1 * near_depth, ndc_x1 * far_depth) * tan_half_x;
+                min_y[cluster] = row_min_y[row];
+                max_y[cluster] = row_max_y[row];
+                min_z[cluster] = near_depth;
+                max_z[cluster] = far_depth;
+            }
+        }
+    }
+}
+
+void ClusterGrid::bin(const Light* scene_lights, size_t count, const glm::mat4& view)
+{
+    lights.clear();
+    center_x.clear(); center_y.clear(); center_z.clear(); radius.clear();
+    first_slice.clear(); last_slice.clear();
+
+    for(size_t i = 0; i < count; i++)
+        if(is_global_light(scene_lights[i]))
+            lights.push_back(pack_light(scene_lights[i]));
+    global_count = lights.size();
+
+    auto slice_of = [&](float depth)
+    {
+        return std::min(std::max((int)std::floor(std::log(depth) * scale + bias), 0), CLUSTER_Z - 1);
+    };
+    for(size_t i = 0; i < count; i++)
+    {
+        const Light& light = scene_lights[i];
+        if(is_global_light(light))
+            continue;
+        glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+        float depth = -center.z;
+        if(depth + light.range < z_near || depth - light.range > z_far)
+            continue;
+        center_x.push_back(center.x);
+        center_y.push_back(center.y);
+        center_z.push_back(depth);
+        radius.push_back(light.range);
+        first_slice.push_back(slice_of(std::max(depth - light.range, z_near)));
+        last_slice.push_back(slice_of(std::min(depth + light.range, z_far)));
+        lights.push_back(pack_light(light));
+    }
+    const size_t n_candidates = center_x.size();
+    const uint32_t first_light = (uint32_t)global_count;
+
+    // every slice is owned by one thread: its (cluster, light) pairs, then a counting sort into cluster order
+    parallel_for(0, CLUSTER_Z, [&](size_t slice_begin, size_t slice_end)
+    {
+        const int CLUSTERS_PER_SLICE = CLUSTER_X * CLUSTER_Y;
+        for(size_t z = slice_begin; z < slice_end; z++)
+        {
+            std::vector<uint32_t>& pairs = slice_pairs[z];
+            pairs.clear();
+            uint32_t counts[CLUSTERS_PER_SLICE] = {};
+
+            for(size_t i = 0; i < n_candidates; i++)
+            {
+                if((int)z < first_slice[i] || (int)z > last_slice[i])
+                    continue;
+                float cy = center_y[i], r2 = radius[i] * radius[i];
+                __m128 cx4 = _mm_set1_ps(center_x[i]);
+                __m128 cy4 = _mm_set1_ps(cy);
+                __m128 cz4 = _mm_set1_ps(center_z[i]);
+                __m128 r24 = _mm_set1_ps(r2);
+                __m128 zero = _mm_setzero_ps();
+                for(int y = 0; y < CLUSTER_Y; y++)
+                {
+                    int row = (int)z * CLUSTER_Y + y;
+                    float dy = std::max(std::max(row_min_y[row] - cy, cy - row_max_y[row]), 0.0f);
+                    if(dy * dy > r2)
+                        continue;
+                    for(int x = 0; x < CLUSTER_X; x += 4)
+                    {
+                        // squared distance from the sphere center to four AABBs at once
+                        int cluster = row * CLUSTER_X + x;
+                        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&min_x[cluster]), cx4), _mm_sub_ps(cx4, _mm_loadu_ps(&max_x[cluster]))), zero);
+                        __m128 dy4 = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&min_y[cluster]), cy4), _mm_sub_ps(cy4, _mm_loadu_ps(&max_y[cluster]))), zero);
+                        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&min_z[cluster]), cz4), _mm_sub_ps(cz4, _mm_loadu_ps(&max_z[cluster]))), zero);
+                        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy4, dy4)), _mm_mul_ps(dz, dz));
+                        int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r24));
+                        while(mask)
+                        {
+                            int bit = __builtin_ctz(mask);
+                            mask &= mask - 1;
+                            uint32_t local = (uint32_t)(y * CLUSTER_X + x + bit);
+                            pairs.push_back(local);
+                            pairs.push_back(first_light + (uint32_t)i);
+                            counts[local]++;
+                        }
+                    }
+                }
+            }
+
+            uint32_t offset = 0;
+            for(int local = 0; local < CLUSTERS_PER_SLICE; local++)
+            {
+                clusters[z * CLUSTERS_PER_SLICE + local] = glm::uvec2(offset, counts[local]);
+                offset += counts[local];
+            }
+            std::vector<uint32_t>& out = slice_indices[z];
+            out.resize(offset);
+            uint32_t cursor[CLUSTERS_PER_SLICE];
+            for(int local = 0; local < CLUSTERS_PER_SLICE; local++)
+                cursor[local] = clusters[z * CLUSTERS_PER_SLICE + local].x;
+            for(size_t p = 0; p < pairs.size(); p += 2)
+                out[cursor[pairs[p]]++] = pairs[p + 1];
+        }
+    });
+
+    // stitch the slices together, offsets were slice local
+    indices.clear();
+    dropped = 0;
+    const int CLUSTERS_PER_SLICE = CLUSTER_X * CLUSTER_Y;
+    for(int z = 0; z < CLUSTER_Z; z++)
+    {
+        uint32_t base = (uint32_t)indices.size();
+        const std::vector<uint32_t>& slice = slice_indices[z];
+        size_t kept = std::min(slice.size(), max_indices - indices.size());
+        indices.insert(indices.end(), slice.begin(), slice.begin() + kept);
+        dropped += slice.size() - kept;
+        for(int local = 0; local < CLUSTERS_PER_SLICE; local++)
+        {
+            glm::uvec2& range = clusters[z * CLUSTERS_PER_SLICE + local];
+            range.y = (uint32_t)std::min<size_t>(range.y, kept - std::min<size_t>(range.x, kept));
+            range.x += base;
+        }
+    }
+}
+
+LightClusters::LightClusters()
+{
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ClustersBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CLUSTERS_BLOCK_BINDING, ID);
+
+    GLint max_texels = 65536; // the 3.3 minimum
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    grid.max_indices = (size_t)max_texels;
+
+    const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for(int i = 0; i < 3; i++)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+        gl_state().bind_texture_unit(CLUSTER_TEXTURE_UNIT + i, GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+}
+
+std::string LightClusters::shader_defines() const
+{
+    return "#define CLUSTERED_LIGHTS\n";
+}
+
+void LightClusters::update(const Light* lights, size_t count, const glm::mat4& view, int viewport_width, int viewport_height)
+{
+    grid.bin(lights, count, view);
+
+    // a fresh store per frame, the driver hands back a new one instead of waiting on last frame's draws
+    auto upload = [](GLuint buffer, const void* data, size_t bytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(bytes, 16), bytes ? data : NULL, GL_STREAM_DRAW);
+    };
+    upload(buffers[0], grid.lights.data(), grid.lights.size() * sizeof(GpuLight));
+    upload(buffers[1], grid.clusters.data(), grid.clusters.size() * sizeof(glm::uvec2));
+    upload(buffers[2], grid.indices.data(), grid.indices.size() * sizeof(uint32_t));
+
+    ClustersBlock block;
+    block.grid = glm::uvec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, (unsigned int)grid.global_count);
+    block.depth = glm::vec4(grid.slice_scale(), grid.slice_bias(), 1.0f / std::max(viewport_width, 1), 1.0f / std::max(viewport_height, 1));
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ClustersBlock), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClustersBlock), &block);
+}
+
+void LightClusters::bind() const
+{
+    for(int i = 0; i < 3; i++)
+        gl_state().bind_texture_unit(CLUSTER_TEXTURE_UNIT + i, GL_TEXTURE_BUFFER, textures[i]);
+}
+
+void LightClusters::destroy()
+{
+    for(int i = 0; i < 3; i++)
+        gl_state().forget_texture(textures[i]);
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+    glDeleteBuffers(1, &ID);
+}
@@ -0,0 +1,121 @@
+#include "Lights.hpp"
+#include "CameraUniforms.hpp"
+#include <algorithm>
+#include <cmath>
+
+bool is_global_light(const Light& light)
+{
+    return light.type == LIGHT_DIRECTIONAL || light.ambient != glm::vec3(0.0f);
+}
+
+Light make_point_light(const glm::vec3& position, const glm::vec3& color, float range)
+{
+    Light light;
+    light.type = LIGHT_POINT;
+    light.position = position;
+    light.diffuse = color;
+    light.specular = color;
+    light.range = range;
+    // fitted to the usual constant / linear / quadratic table (range 50: 0.09, 0.03)
+    light.linear = 4.5f / range;
+    light.quadratic = 75.0f / (range * range);
+    return light;
+}
+
+Light make_spot_light(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float range, float inner_degrees, float outer_degrees)
+{
+    Light light = make_point_light(position, color, range);
+    light.type = LIGHT_SPOT;
+    light.direction = glm::normalize(direction);
+    light.inner_cutoff = std::cos(glm::radians(inner_degrees));
+    light.outer_cutoff = std::cos(glm::radians(outer_degrees));
+    return light;
+}
+
+Light make_directional_light(const glm::vec3& direction, const glm::vec3& color)
+{
+    Light light;
+    light.type = LIGHT_DIRECTIONAL;
+    light.direction = glm::normalize(direction);
+    light.ambient = 0.1f * color;
+    light.diffuse = color;
+    light.specular = color;
+    light.linear = 0.0f;
+    light.quadratic = 0.0f;
+    return light;
+}
+
+GpuLight pack_light(const Light& light)
+{
+    GpuLight gpu;
+    gpu.position = glm::vec4(light.position, (float)light.type);
+    gpu.direction = glm::vec4(light.direction, light.range);
+    gpu.ambient = glm::vec4(light.ambient, 0.0f);
+    gpu.diffuse = glm::vec4(light.diffuse, light.inner_cutoff);
+    gpu.specular = glm::vec4(light.specular, light.outer_cutoff);
+    gpu.attenuation = glm::vec4(light.constant, light.linear, light.quadratic, 0.0f);
+    return gpu;
+}
+
+LightUniforms::LightUniforms(size_t max_lights)
+    : visible(0), culled(0), dropped(0)
+{
+    GLint max_block_size = 16384; // the minimum every 3.3 implementation has to offer
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+    this->max_lights = std::min(max_lights, ((size_t)max_block_size - sizeof(glm::ivec4)) / sizeof(GpuLight));
+
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::ivec4) + this->max_lights * sizeof(GpuLight), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, ID);
+    packed.reserve(this->max_lights);
+}
+
+std::string LightUniforms::shader_defines() const
+{
+    return "#define MAX_LIGHTS " + std::to_string(max_lights) + "\n";
+}
+
+void LightUniforms::update(const Light* lights, size_t count, const Frustum& frustum, const glm::vec3& view_position)
+{
+    survivors.clear();
+    for(size_t i = 0; i < count; i++)
+    {
+        const Light& light = lights[i];
+        if(is_global_light(light) || frustum.intersects_sphere(light.position, light.range))
+            survivors.push_back(&light);
+    }
+    visible = survivors.size();
+    culled = count - visible;
+    dropped = 0;
+
+    // more visible lights than the block holds: keep the nearest (global lights count as distance 0)
+    if(survivors.size() > max_lights)
+    {
+        auto distance = [&](const Light* light)
+        {
+            return is_global_light(*light) ? 0.0f : glm::length(light->position - view_position) - light->range;
+        };
+        std::nth_element(survivors.begin(), survivors.begin() + max_lights, survivors.end(),
+                         [&](const Light* a, const Light* b) { return distance(a) < distance(b); });
+        dropped = survivors.size() - max_lights;
+        survivors.resize(max_lights);
+    }
+
+    packed.resize(survivors.size());
+    for(size_t i = 0; i < survivors.size(); i++)
+        packed[i] = pack_light(*survivors[i]);
+
+    // only the used prefix is uploaded, the orphaned buffer keeps its full size
+    glm::ivec4 header((int)packed.size(), 0, 0, 0);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::ivec4) + max_lights * sizeof(GpuLight), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(header), &header);
+    if(!packed.empty())
+        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::ivec4), packed.size() * sizeof(GpuLight), packed.data());
+}
+
+void LightUniforms::destroy()
+{
+    glDeleteBuffers(1, &ID);
+}
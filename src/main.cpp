@@ -8,16 +8,65 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "Shader.hpp"
 #include "Camera.hpp"
-#include "stb_image.h"
+#include "Benchmarks.hpp"
+#include "InstanceBuffer.hpp"
+#include "FrameTimer.hpp"
+#include "SierpinskiMesh.hpp"
+#include "sierpinski.hpp"
+#include "Mesh.hpp"
+#include "MeshArena.hpp"
+#include "IndirectBatch.hpp"
+#include "Sphere.hpp"
+#include "Cone.hpp"
+#include "RenderQueue.hpp"
+#include "CameraUniforms.hpp"
+#include "TextureLoader.hpp"
+#include "TextureManager.hpp"
+#include "MaterialLibrary.hpp"
+#include "TextureStreamer.hpp"
+#include "Lights.hpp"
+#include "LightClusters.hpp"
+#include "GBuffer.hpp"
+#include "Culling.hpp"
+#include "Bvh.hpp"
+#include "OcclusionCuller.hpp"
+#include "Frustum.hpp"
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
-#include <stack>
+#include <cmath>
+#include <algorithm>
 
 #define UI_ENABLED 0
 #define RENDER_NORMALS 1
+#define BENCHMARK_UNIFORMS 0	// times per-draw uniform uploads (name lookup vs cached handle) at startup
+#define STRESS_INSTANCE_COUNT 0	// > 0 replaces the 10 cubes with a grid of this many cubes (stress scene)
+#define REPORT_FRAME_TIME (STRESS_INSTANCE_COUNT || BENCHMARK_LIGHTS)
+#define RENDER_SIERPINSKI 0		// instanced sierpinski triangle behind the cubes
+#define SIERPINSKI_DEGREE 8
+#define BENCHMARK_SIERPINSKI 0	// times sierpinski transform generation for degrees 8-14 at startup
+#define RENDER_SPHERES 0		// row of receding spheres, each drawn at the LOD its screen size needs
+#define RENDER_CONES 0			// ring of differently sized cones sharing one set of LOD meshes
+#define BENCHMARK_CONES 0		// times cone generation and cached spawning at startup
+#define BENCHMARK_TEXTURE_COMPRESSION 0	// BC encoder speed and quality on res/ at startup
+#define MATERIAL_ARRAYS 1		// textured objects cycle through res/ materials packed into texture arrays (one bind for all)
+#define STREAM_TEXTURES 1		// without MATERIAL_ARRAYS: container maps stream their mips in from the pack by on-screen size
+#define STREAMING_BUDGET_MB 32
+#define SCENE_LIGHTS 4			// coloured point lights around the cubes, on top of the flashlight
+#define BENCHMARK_LIGHTS 0		// cycles 1/16/256/1024 lights every few seconds, frame times are reported per count
+#define CLUSTERED_LIGHTS 1		// bin lights into a 16x9x24 view space grid, each fragment only shades its cluster's lights
+#define BENCHMARK_LIGHT_BINNING 0	// times binning 10k lights into the cluster grid at startup
+#define FRUSTUM_CULLING 1		// only cubes inside the camera frustum are written to the instance buffer / submitted
+#define BENCHMARK_CULLING 0		// times scalar vs SIMD frustum culling of 1M objects at startup
+#define BVH_CULLING 1			// FRUSTUM_CULLING walks a BVH over the cube bounds instead of testing every cube
+#define BENCHMARK_BVH 0			// times BVH build, refit, culling and raycasts over 1M objects at startup
+#define OCCLUSION_CULLING 1		// the nearest frustum visible cubes are rasterized on the CPU and hide the cubes behind them
+#define OCCLUSION_OCCLUDERS 16	// how many of the nearest cubes are drawn into the occlusion depth buffer
+#define BENCHMARK_OCCLUSION 0	// times occluder rasterization and Hi-Z tests of a cube lattice behind a wall at startup
+#define MULTI_DRAW_INDIRECT 1	// instanced mode packs cubes, spheres and cones into one indirect batch (one MDI call per pass)
+#define BENCHMARK_MESH_ALLOCATOR 0	// times mesh arena sub-allocation (TLSF vs first fit) under churn at startup
 
 #ifndef M_PI 	// manually defined pi constant for use in calculations
 #define M_PI 3.14159265358979323846
@@ -26,12 +75,12 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double x_offset, double y_offset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void process_input(GLFWwindow* window);
 void calculate_delta_time();
 void draw_cube(Shader& shader);
-void draw_sierpinski(Shader& shader, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree);
+void draw_sierpinski(SierpinskiMesh& mesh, Shader& shader, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree);
 void drawTexturedTriangle(Shader& shader, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3);
-unsigned int loadTexture(char const* path);
 
 
 // Settings
@@ -51,8 +100,24 @@ float last_frame_time = 0.0f;
 // lighting
 glm::vec3 lightPos(0.0f, 1.8f, 3.0f);
 
+// render modes (toggled at runtime, see key_callback)
+bool instanced_rendering = true;
+bool deferred_shading = false;
+bool pick_requested = false; // P: raycast from the camera and report the cube hit
+bool multi_draw_indirect = true; // M: one glMultiDrawElementsIndirect vs the per-command fallback loop
+
 int main()
 {
+	#if BENCHMARK_SIERPINSKI
+		benchmark_sierpinski();
+	#endif
+	#if BENCHMARK_CONES
+		benchmark_cone_generation();
+	#endif
+	#if BENCHMARK_TEXTURE_COMPRESSION
+		benchmark_texture_compression();
+	#endif
+
 	// Init GLFW
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -72,6 +137,7 @@ int main()
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// Init GLAD
@@ -90,6 +156,9 @@ int main()
 	int nAttributes;
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nAttributes);
 	std::cout << "GPU Vertex Attributes supported::" << nAttributes << std::endl;
+	// GL 4.3 entry point, glad only loads 3.3
+	bool multiDrawSupported = load_multi_draw_indirect((GLADloadproc)glfwGetProcAddress);
+	std::cout << "GPU Multi draw indirect::" << (multiDrawSupported ? "supported" : "not supported, per-draw fallback") << std::endl;
 
 	// imgui setup stuff
 	#if UI_ENABLED
@@ -148,82 +217,169 @@ int main()
         -0.5f,  0.5f,  0.5f,  	0.0f,  1.0f,  0.0f,  	0.0f,  0.0f,
         -0.5f,  0.5f, -0.5f,  	0.0f,  1.0f,  0.0f,  	0.0f,  1.0f,
 	};	
-	unsigned int colorCubeVAO, VBO;
-	glGenVertexArrays(1, &colorCubeVAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(colorCubeVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	// pos attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),  (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// diffuse map texture attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	// weld the 36 soup vertices into an indexed, cache-ordered mesh
+	MeshBuilder cubeBuilder;
+	cubeBuilder.add_triangles(vertices, sizeof(vertices) / (8 * sizeof(float)));
+	MeshData cubeData = cubeBuilder.build();
+	std::cout << "MESH::CUBE::vertices " << sizeof(vertices) / (8 * sizeof(float)) << " -> " << cubeData.vertices.size()
+			  << ", ACMR " << cubeBuilder.acmr_before << " -> " << cubeBuilder.acmr_after << std::endl;
+	// every mesh lives in one arena: a vertex buffer and VAO per vertex format, one shared index buffer
+	MeshArena meshArena;
+	MeshRange cubeRange = meshArena.add(cubeData);
 
 	// setup for rendering normal lines
 	std::vector<float> normalLinesVerticies;
 	float normalLineLength = 0.2f; // for visualization, not for real interpretation;
-	for(size_t i = 0; i < sizeof(vertices) / sizeof(vertices[0]); i += 8)
+	for(const Vertex& vertex : cubeData.vertices)
 	{
-		float vx = vertices[i];
-		float vy = vertices[i+1];
-		float vz = vertices[i+2];
-
-		float nx = vertices[i+3];
-		float ny = vertices[i+4];
-		float nz = vertices[i+5];
-
-		// start point (vertex position)
-		normalLinesVerticies.push_back(vx);
-		normalLinesVerticies.push_back(vy);
-		normalLinesVerticies.push_back(vz);
-
-		// End point (vertex position + normal * scale)
-		normalLinesVerticies.push_back(vx + nx * normalLineLength);
-		normalLinesVerticies.push_back(vy + ny * normalLineLength);
-		normalLinesVerticies.push_back(vz + nz * normalLineLength);
+		glm::vec3 start = vertex.position; // vertex position
+		glm::vec3 end = vertex.position + vertex.normal * normalLineLength; // vertex position + normal * scale
+
+		normalLinesVerticies.insert(normalLinesVerticies.end(), { start.x, start.y, start.z, end.x, end.y, end.z });
 	}
 
-	unsigned int normalLinesVAO, normalLinesVBO;
-	glGenVertexArrays(1, &normalLinesVAO);
-	glGenBuffers(1, &normalLinesVBO);
-	glBindVertexArray(normalLinesVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, normalLinesVBO);
-	glBufferData(GL_ARRAY_BUFFER, normalLinesVerticies.size() * sizeof(float), normalLinesVerticies.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	MeshRange normalLinesRange = meshArena.add(FORMAT_POSITION, normalLinesVerticies.data(), normalLinesVerticies.size() / 3);
 
 	// Setup for light source cube
 	unsigned int lightCubeVAO;
 	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	gl_state().bind_vertex_array(lightCubeVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, meshArena.vbo(FORMAT_LIT));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshArena.EBO);
 	// pos attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 	glEnableVertexAttribArray(0);
 
 
+	// light block first, its capacity is compiled into the shaders that read it
+	#if CLUSTERED_LIGHTS
+	LightClusters lightClusters;
+	std::string lightDefines = lightClusters.shader_defines();
+	#else
+	LightUniforms lightUniforms;
+	std::string lightDefines = lightUniforms.shader_defines();
+	#endif
+
 	// setup shaders
-	Shader colorObjShader("shaders/color_cube.vert", "shaders/color_cube.frag");
+	Shader colorObjShader("shaders/color_cube.vert", "shaders/color_cube.frag", lightDefines + (MATERIAL_ARRAYS ? "#define MATERIAL_ARRAY\n" : ""));
+	// deferred path (G key): the same material and lighting code split into a G-buffer pass and a full-screen pass
+	Shader gbufferShader("shaders/color_cube.vert", "shaders/color_cube.frag", std::string("#define GBUFFER_PASS\n") + (MATERIAL_ARRAYS ? "#define MATERIAL_ARRAY\n" : ""));
+	Shader deferredLightShader("shaders/fullscreen.vert", "shaders/color_cube.frag", lightDefines + "#define DEFERRED_LIGHTING\n");
 	Shader lightSrcShader("shaders/light_cube.vert", "shaders/light_cube.frag");
 	Shader normalLinesShader("shaders/normal_lines.vert", "shaders/normal_lines.frag");
 	
-	// load textures
-	unsigned int diffuseMap = loadTexture("D:/aarons graphics/res/container2.png");
-	unsigned int specularMap = loadTexture("D:/aarons graphics/res/container2_specular.png");
-	//unsigned int emissionMap = loadTexture("D:/aarons graphics/res/matrix_emission_map.jpg");
+	// load textures, decoded in the background and uploaded a few per frame by textureLoader.pump()
+	TextureLoader textureLoader;
+	TextureManager textureManager(textureLoader);
+	TexturePack texturePack; // cooked by tools/texture_cooker, images not in it are still decoded at runtime
+	if(texturePack.open("../res/textures.pack"))
+		textureManager.set_pack(&texturePack);
+	else
+		std::cout << "TEXTURES::no texture pack, decoding images at runtime" << std::endl;
+	TextureHandle diffuseMap = textureManager.acquire("D:/aarons graphics/res/container2.png");
+	TextureHandle specularMap = textureManager.acquire("D:/aarons graphics/res/container2_specular.png");
+	//TextureHandle emissionMap = textureManager.acquire("D:/aarons graphics/res/matrix_emission_map.jpg");
+
+#if MATERIAL_ARRAYS
+	MaterialLibrary materials(512, 8);
+	materials.add("D:/aarons graphics/res/container2.png", "D:/aarons graphics/res/container2_specular.png");
+	materials.add("D:/aarons graphics/res/StoneFloorTexture.png");
+	materials.add("D:/aarons graphics/res/wall.jpg");
+	const int materialCount = std::max(1, materials.size());
+	// every textured draw binds the same two arrays, so they all share one material sort id
+	auto apply_material = [&](DrawCommand& draw, int index)
+	{
+		draw.textures[0] = materials.diffuse.ID;
+		draw.textures[1] = materials.specular.ID;
+		draw.texture_target = GL_TEXTURE_2D_ARRAY;
+		draw.layer = index % materialCount;
+		draw.material = 1;
+	};
+#else
+	const int materialCount = 1;
+	#if STREAM_TEXTURES
+	TextureStreamer textureStreamer(texturePack, (size_t)STREAMING_BUDGET_MB << 20);
+	StreamHandle streamedDiffuse, streamedSpecular;
+	if(texturePack.is_open())
+	{
+		streamedDiffuse = textureStreamer.add("D:/aarons graphics/res/container2.png");
+		streamedSpecular = textureStreamer.add("D:/aarons graphics/res/container2_specular.png");
+	}
+	#endif
+	auto apply_material = [&](DrawCommand& draw, int)
+	{
+		draw.textures[0] = textureManager.texture(diffuseMap);
+		draw.textures[1] = textureManager.texture(specularMap);
+		#if STREAM_TEXTURES
+		if(streamedDiffuse.valid() && streamedSpecular.valid())
+		{
+			draw.textures[0] = textureStreamer.texture(streamedDiffuse);
+			draw.textures[1] = textureStreamer.texture(streamedSpecular);
+		}
+		#endif
+		draw.material = 1;
+	};
+#endif
 
 	// pass in uniforms
 	colorObjShader.use();
 	colorObjShader.setInt("material.diffuseMap", 0);
 	colorObjShader.setInt("material.specularMap", 1);
 	//colorObjShader.setInt("material.emissionMap", 2);
+	#if CLUSTERED_LIGHTS
+	colorObjShader.setInt("clusterLights", CLUSTER_TEXTURE_UNIT);
+	colorObjShader.setInt("clusterRanges", CLUSTER_TEXTURE_UNIT + 1);
+	colorObjShader.setInt("clusterIndices", CLUSTER_TEXTURE_UNIT + 2);
+	#endif
+	gbufferShader.use();
+	gbufferShader.setInt("material.diffuseMap", 0);
+	gbufferShader.setInt("material.specularMap", 1);
+	gbufferShader.setFloat("material.shininess", 0.6f * 128.0f); // constant, stored per pixel for the lighting pass
+	deferredLightShader.use();
+	deferredLightShader.setInt("gAlbedo", GBUFFER_TEXTURE_UNIT);
+	deferredLightShader.setInt("gSpecular", GBUFFER_TEXTURE_UNIT + 1);
+	deferredLightShader.setInt("gNormal", GBUFFER_TEXTURE_UNIT + 2);
+	deferredLightShader.setInt("gDepth", GBUFFER_TEXTURE_UNIT + 3);
+	#if CLUSTERED_LIGHTS
+	deferredLightShader.setInt("clusterLights", CLUSTER_TEXTURE_UNIT);
+	deferredLightShader.setInt("clusterRanges", CLUSTER_TEXTURE_UNIT + 1);
+	deferredLightShader.setInt("clusterIndices", CLUSTER_TEXTURE_UNIT + 2);
+	#endif
+
+	// uniform handles, resolved once so the render loop never looks up a name
+	const UniformHandle cubeShininessLoc = colorObjShader.uniform(uniform_hash("material.shininess"));
 
-	glm::vec3 cubePositions[] = 
+	#if BENCHMARK_UNIFORMS
+		benchmark_uniform_upload(colorObjShader);
+	#endif
+	#if BENCHMARK_LIGHT_BINNING
+		benchmark_light_binning();
+	#endif
+	#if BENCHMARK_CULLING
+		benchmark_frustum_culling();
+	#endif
+	#if BENCHMARK_BVH
+		benchmark_bvh();
+	#endif
+	#if BENCHMARK_OCCLUSION
+		benchmark_occlusion_culling();
+	#endif
+	#if BENCHMARK_MESH_ALLOCATOR
+		benchmark_mesh_allocator();
+	#endif
+
+#if STRESS_INSTANCE_COUNT
+	// stress scene: a cubic lattice of cubes in front of the camera
+	std::vector<glm::vec3> cubePositions;
+	cubePositions.reserve(STRESS_INSTANCE_COUNT);
+	int latticeSide = (int)std::ceil(std::cbrt((double)STRESS_INSTANCE_COUNT));
+	for(int i = 0; i < STRESS_INSTANCE_COUNT; i++)
+	{
+		int x = i % latticeSide, y = (i / latticeSide) % latticeSide, z = i / (latticeSide * latticeSide);
+		cubePositions.push_back(2.0f * glm::vec3(x - latticeSide / 2, y - latticeSide / 2, -z));
+	}
+#else
+	std::vector<glm::vec3> cubePositions = 
 	{
 		glm::vec3( 0.0f,  0.0f,  0.0f),
     	glm::vec3( 2.0f,  5.0f, -15.0f),
@@ -236,12 +392,185 @@ int main()
     	glm::vec3( 1.5f,  0.2f, -1.5f),
     	glm::vec3(-1.3f,  1.0f, -1.5f)
 	};
+#endif
+
+	// the cubes never move, so their transforms are built and uploaded once
+	std::vector<InstanceData> cubeInstances(cubePositions.size());
+	for(size_t i = 0; i < cubePositions.size(); i++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		float angle = 20.0f * i;
+		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+		cubeInstances[i].model = model;
+		cubeInstances[i].normalMat = glm::transpose(glm::inverse(model));
+		cubeInstances[i].layer = (uint32_t)(i % materialCount);
+	}
+	InstanceBuffer cubeInstanceBuffer;
+	cubeInstanceBuffer.upload(cubeInstances.data(), cubeInstances.size());
+	// world AABBs of the (rotated) unit cubes for culling, and the indices of the ones in view this frame
+	CullBounds cubeBounds;
+	cubeBounds.reserve(cubeInstances.size());
+	for(const InstanceData& instance : cubeInstances)
+		cubeBounds.add_transformed_aabb(glm::vec3(-0.5f), glm::vec3(0.5f), instance.model);
+	std::vector<uint32_t> visibleCubes(cubeInstances.size());
+	for(size_t i = 0; i < visibleCubes.size(); i++)
+		visibleCubes[i] = (uint32_t)i;
+	size_t visibleCubeCount = visibleCubes.size();
+	std::vector<InstanceData> visibleCubeInstances;
+	// the cubes are static, so the tree is built once (a moving scene would refit() it every frame)
+	Bvh cubeBvh;
+	cubeBvh.build(cubeBounds);
+	std::cout << "BVH::CUBES::" << cubeBvh.nodes.size() << " nodes, depth " << cubeBvh.depth() << std::endl;
+	// the closest cubes in view act as occluders for the rest, they always pass their own test
+	OcclusionCuller occlusionCuller;
+	std::vector<uint32_t> occluderCubes;
+	#if MULTI_DRAW_INDIRECT
+	// owns the arena VAO's instance attributes, every lit instance of the frame goes through it
+	IndirectBatch litBatch(meshArena);
+	#else
+	cubeInstanceBuffer.attach(meshArena.vao(FORMAT_LIT), 3);
+	#endif
+	// the normal lines are the only FORMAT_POSITION mesh, so that VAO's instances are the cubes'
+	cubeInstanceBuffer.attach(meshArena.vao(FORMAT_POSITION), 3);
+
+#if RENDER_SIERPINSKI
+	// sierpinski triangle in one draw: the base triangle instanced once per leaf transform
+	float sierpinskiTriangle[] =
+	{	// positions			// colors
+		-1.0f, -1.0f, 0.0f,		1.0f, 0.0f, 0.0f,
+		 1.0f, -1.0f, 0.0f,		0.0f, 1.0f, 0.0f,
+		 0.0f,  1.0f, 0.0f,		0.0f, 0.0f, 1.0f
+	};
+	std::vector<glm::mat4> sierpinskiTransforms;
+	glm::mat4 sierpinskiRoot = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -25.0f)), glm::vec3(10.0f));
+	setup_sierpinski(sierpinskiTransforms, SIERPINSKI_DEGREE, sierpinskiRoot);
+
+	MeshRange sierpinskiRange = meshArena.add(FORMAT_COLORED, sierpinskiTriangle, 3);
+	unsigned int sierpinskiInstanceVBO;
+	glGenBuffers(1, &sierpinskiInstanceVBO);
+	gl_state().bind_vertex_array(meshArena.vao(FORMAT_COLORED));
+	// per-instance leaf transform, on the shared FORMAT_COLORED VAO (the triangle is its only instanced user)
+	glBindBuffer(GL_ARRAY_BUFFER, sierpinskiInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, sierpinskiTransforms.size() * sizeof(glm::mat4), sierpinskiTransforms.data(), GL_STATIC_DRAW);
+	for(unsigned int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribDivisor(3 + column, 1);
+	}
+	gl_state().bind_vertex_array(0);
+	Shader sierpinskiShader("shaders/sierpinski.vert", "shaders/sierpinski.frag");
+#endif
+
+#if RENDER_SPHERES
+	const int SPHERE_LODS = 5;
+	std::vector<MeshRange> sphereLods;
+	for(const MeshData* lod : Sphere::get_lod_chain(64, 128, SPHERE_LODS))
+		sphereLods.push_back(meshArena.add(*lod));
+#endif
+
+#if RENDER_CONES
+	const int CONE_LODS = 4;
+	std::vector<MeshRange> coneLods;
+	for(const MeshData* lod : Cone::get_lod_chain(64, 4, CONE_LODS))
+		coneLods.push_back(meshArena.add(*lod));
+	// cones of different sizes and directions, none of them generate geometry
+	std::vector<glm::mat4> coneModels;
+	for(int i = 0; i < 64; i++)
+	{
+		float angle = glm::radians(360.0f * i / 64.0f);
+		glm::vec3 position(10.0f * cos(angle), -3.0f, 10.0f * sin(angle));
+		glm::vec3 direction(0.3f * cos(3.0f * angle), 1.0f, 0.3f * sin(3.0f * angle));
+		coneModels.push_back(Cone::get_model_matrix(position, 0.3f + 0.1f * (i % 5), 1.0f + 0.25f * (i % 7), direction));
+	}
+#endif
+
+	meshArena.print_report();
+
+	// scene lights: [0] is the flashlight, [1] orbits the cubes, the rest are static
+	std::vector<Light> sceneLights;
+	sceneLights.push_back(make_spot_light(camera.position, camera.front, glm::vec3(1.0f), 50.0f, 12.5f, 17.5f));
+	sceneLights[0].ambient = glm::vec3(0.1f);
+	sceneLights[0].diffuse = glm::vec3(0.5f);
+	const glm::vec3 lightColors[] = { glm::vec3(1.0f, 0.3f, 0.2f), glm::vec3(0.2f, 1.0f, 0.3f), glm::vec3(0.2f, 0.4f, 1.0f), glm::vec3(1.0f, 0.9f, 0.4f) };
+	#if BENCHMARK_LIGHTS
+	const int lightCount = 1024;
+	#else
+	const int lightCount = 1 + SCENE_LIGHTS;
+	#endif
+	for(int i = 1; i < lightCount; i++)
+	{
+		// spread over a 24 x 8 x 24 box around the cubes
+		glm::vec3 position(-12.0f + 24.0f * ((i * 37) % 64) / 64.0f, -4.0f + 8.0f * ((i * 11) % 16) / 16.0f, -16.0f + 24.0f * ((i * 23) % 64) / 64.0f);
+		sceneLights.push_back(make_point_light(position, lightColors[i % 4], BENCHMARK_LIGHTS ? 4.0f : 8.0f));
+	}
+	#if BENCHMARK_LIGHTS
+	const size_t benchmarkLightCounts[] = { 1, 16, 256, 1024 };
+	#if !CLUSTERED_LIGHTS
+	if(lightUniforms.capacity() < (size_t)lightCount)
+		std::cout << "BENCHMARK::LIGHTS the Lights block holds " << lightUniforms.capacity() << " lights on this device, "
+				  << "counts above that shade only the nearest " << lightUniforms.capacity() << std::endl;
+	#endif
+	#endif
+
+	CameraUniforms cameraUniforms;
+	RenderQueue renderQueue;
+	FrameTimer frameTimer;
+	int framebufferWidth, framebufferHeight;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	GBuffer gbuffer(framebufferWidth, framebufferHeight);
 	
 	// Render Loop
 	while (!glfwWindowShouldClose(window))
 	{
 		// per-frame time logic
 		calculate_delta_time();
+		gl_state().begin_frame();
+		textureLoader.pump(2.0);
+		#if BENCHMARK_LIGHTS
+			size_t activeLights = benchmarkLightCounts[(size_t)(glfwGetTime() / 5.0) % 4];
+		#else
+			size_t activeLights = sceneLights.size();
+		#endif
+		#if REPORT_FRAME_TIME
+			#if BENCHMARK_LIGHTS
+			std::string frameMode = "LIGHTS_" + std::to_string(activeLights);
+			#if !CLUSTERED_LIGHTS
+			if(activeLights > lightUniforms.capacity()) // only the nearest capacity() are shaded, the rest show up as dropped
+				frameMode += "_CAPPED_" + std::to_string(lightUniforms.capacity());
+			#endif
+			#else
+			std::string frameMode = instanced_rendering ? "INSTANCED" : "PER_DRAW";
+			#if MULTI_DRAW_INDIRECT
+			if(instanced_rendering)
+				frameMode = (multiDrawSupported && multi_draw_indirect) ? "MULTI_DRAW" : "MULTI_DRAW_FALLBACK";
+			#endif
+			#endif
+			frameMode += deferred_shading ? "_DEFERRED" : "_FORWARD";
+			if(frameTimer.tick(delta_time, frameMode))
+			{
+				#if CLUSTERED_LIGHTS
+				std::cout << "LIGHTS::" << lightClusters.grid.lights.size() << " in depth range, " << lightClusters.grid.indices.size()
+						  << " cluster indices, dropped " << lightClusters.grid.dropped << std::endl;
+				#else
+				std::cout << "LIGHTS::visible " << lightUniforms.visible << ", culled " << lightUniforms.culled
+						  << ", dropped " << lightUniforms.dropped << " over the capacity of " << lightUniforms.capacity() << std::endl;
+				#endif
+				std::cout << "CULLING::" << visibleCubeCount << " of " << cubeInstances.size() << " cubes visible" << std::endl;
+				#if FRUSTUM_CULLING && OCCLUSION_CULLING
+				std::cout << "OCCLUSION::" << occlusionCuller.occluded << " of " << occlusionCuller.tested << " cubes hidden by "
+						  << occlusionCuller.occluder_triangles << " occluder triangles" << std::endl;
+				#endif
+				std::cout << "GL_STATE::binds issued " << gl_state().issued_last_frame << ", dropped " << gl_state().dropped_last_frame
+						  << " per frame, " << renderQueue.draws << " draws, " << renderQueue.program_changes << " program changes" << std::endl;
+				textureManager.print_report();
+				meshArena.print_report();
+				#if STREAM_TEXTURES && !MATERIAL_ARRAYS
+				textureStreamer.print_report();
+				#endif
+			}
+		#endif
+		renderQueue.clear(); // last frame's draw counts were reported above
 
 		#if UI_ENABLED
 			// Start the ImGui frame
@@ -259,85 +588,223 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		colorObjShader.use();
-        colorObjShader.setVec3("viewPos", camera.position);
-        colorObjShader.setFloat("material.shininess", 0.6f * 128.0f);
-		// bind diffuse map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		// bind specular map
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
-		// bind emission map
-		//glActiveTexture(GL_TEXTURE2);
-		//glBindTexture(GL_TEXTURE_2D, emissionMap);
+		colorObjShader.set(cubeShininessLoc, 0.6f * 128.0f);
 		
 		// light properties
 		float radius = 4.0f;
 		glm::vec3 dynamicLightPos = glm::vec3(radius * cos(static_cast<float>(glfwGetTime()) / 2), 0.0f, radius * sin(static_cast<float>(glfwGetTime()) / 2));
-		colorObjShader.setVec3("light.position", camera.position);
-		colorObjShader.setVec3("light.direction", camera.front);
-		colorObjShader.setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
-
-        colorObjShader.setVec3("light.ambient", glm::vec3(0.1f));
-        colorObjShader.setVec3("light.diffuse", glm::vec3(0.5f));
-        colorObjShader.setVec3("light.specular", glm::vec3(1.0f));
-		colorObjShader.setFloat("light.constant", 1.0f);
-		colorObjShader.setFloat("light.linear", 0.09f);
-		colorObjShader.setFloat("light.quadratic", 0.032f);
+		sceneLights[0].position = camera.position;
+		sceneLights[0].direction = camera.front;
+		if(sceneLights.size() > 1)
+			sceneLights[1].position = dynamicLightPos;
 
 		// pass projection matrix to shader (note: in this case, it can change every frame)
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)(SCREEN_WIDTH / SCREEN_HEIGHT), 0.1f, 100.0f); // NOTE: aspect ratio will determine FOV_X
 		glm::mat4 view = camera.get_view_matrix();
-		colorObjShader.setMat4("projection", projection);
-		colorObjShader.setMat4("view", view);  
+		// one upload per frame, every program reads it through the Camera block
+		cameraUniforms.update(projection, view, camera.position);
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		#if CLUSTERED_LIGHTS
+		// clusters follow the same projection, lights outside every cluster never reach the shader
+		lightClusters.grid.set_projection(camera.fov, (float)(SCREEN_WIDTH / SCREEN_HEIGHT), 0.1f, 100.0f);
+		lightClusters.update(sceneLights.data(), std::min(activeLights, sceneLights.size()), view, framebufferWidth, framebufferHeight);
+		lightClusters.bind();
+		#else
+		// lights outside the view frustum never reach the shader loop
+		lightUniforms.update(sceneLights.data(), std::min(activeLights, sceneLights.size()), Frustum::from_matrix(projection * view), camera.position);
+		#endif
 
 
-		glm::mat4 model(1.0f); // quick reset
+		if(pick_requested)
+		{
+			BvhHit hit;
+			if(cubeBvh.raycast(camera.position, camera.front, 100.0f, hit))
+				std::cout << "PICK::cube " << hit.object << " at " << hit.t << std::endl;
+			else
+				std::cout << "PICK::nothing" << std::endl;
+			pick_requested = false;
+		}
 
-		// render the 10 cubes
-		for(int i = 0; i < 10; i++)
+		// lit surfaces go through the G-buffer program in deferred mode, everything else is unchanged
+		Shader& surfaceShader = deferred_shading ? gbufferShader : colorObjShader;
+		DrawCommand cubeDraw = mesh_draw_command(surfaceShader, meshArena, cubeRange);
+		apply_material(cubeDraw, 0);
+		#if MULTI_DRAW_INDIRECT
+		litBatch.clear();
+		litBatch.use_multi_draw = multi_draw_indirect;
+		#endif
+		#if RENDER_SPHERES || RENDER_CONES
+		// lit objects with their own transform: an instance of the batch, or a draw of their own
+		auto submit_surface = [&](const MeshRange& mesh, const glm::mat4& model, int materialIndex, float depth01)
 		{
-			colorObjShader.use();
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			colorObjShader.setMat4("model", model);
-			glm::mat4 normalMat = glm::transpose(glm::inverse(model));
-			colorObjShader.setMat4("normalMat", normalMat);
-
-			glBindVertexArray(colorCubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-
-
-			// render normal lines visually
-			#if RENDER_NORMALS 
-			normalLinesShader.use();
-			normalLinesShader.setMat4("projection", projection);
-			normalLinesShader.setMat4("view", view);
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			normalLinesShader.setMat4("model", model);
-
-			glBindVertexArray(normalLinesVAO);
-			glDrawArrays(GL_LINES, 0, normalLinesVerticies.size() / 3);
+			#if MULTI_DRAW_INDIRECT
+			if(instanced_rendering)
+			{
+				InstanceData instance;
+				instance.model = model;
+				instance.normalMat = glm::transpose(glm::inverse(model));
+				instance.layer = (uint32_t)(materialIndex % materialCount);
+				litBatch.add(mesh, instance);
+				return;
+			}
 			#endif
+			DrawCommand draw = mesh_draw_command(surfaceShader, meshArena, mesh);
+			apply_material(draw, materialIndex);
+			draw.model = model;
+			draw.normalMat = glm::transpose(glm::inverse(model));
+			renderQueue.submit(PASS_OPAQUE, draw, depth01);
+		};
+		#endif
+
+		DrawCommand normalLinesDraw = mesh_draw_command(normalLinesShader, meshArena, normalLinesRange);
+		normalLinesDraw.mode = GL_LINES;
+
+		#if FRUSTUM_CULLING && BVH_CULLING
+		visibleCubeCount = cubeBvh.cull(camera.get_frustum(projection), visibleCubes.data());
+		#elif FRUSTUM_CULLING
+		visibleCubeCount = cull_aabbs(camera.get_frustum(projection), cubeBounds, visibleCubes.data());
+		#endif
+		#if FRUSTUM_CULLING && OCCLUSION_CULLING
+		{
+			size_t occluderCount = std::min((size_t)OCCLUSION_OCCLUDERS, visibleCubeCount);
+			occluderCubes.assign(visibleCubes.begin(), visibleCubes.begin() + visibleCubeCount);
+			auto distanceTo = [&](uint32_t i) {
+				glm::vec3 d = glm::vec3(cubeBounds.center_x[i], cubeBounds.center_y[i], cubeBounds.center_z[i]) - camera.position;
+				return glm::dot(d, d);
+			};
+			std::partial_sort(occluderCubes.begin(), occluderCubes.begin() + occluderCount, occluderCubes.end(),
+							  [&](uint32_t a, uint32_t b) { return distanceTo(a) < distanceTo(b); });
+			occlusionCuller.begin(projection * view);
+			for(size_t o = 0; o < occluderCount; o++)
+				occlusionCuller.add_occluder(cubeData, cubeInstances[occluderCubes[o]].model);
+			occlusionCuller.rasterize();
+			visibleCubeCount = occlusionCuller.cull(cubeBounds, visibleCubes.data(), visibleCubeCount, visibleCubes.data());
+		}
+		#endif
+		#if FRUSTUM_CULLING
+		if(instanced_rendering)
+		{
+			visibleCubeInstances.resize(visibleCubeCount);
+			for(size_t v = 0; v < visibleCubeCount; v++)
+				visibleCubeInstances[v] = cubeInstances[visibleCubes[v]];
+			#if !MULTI_DRAW_INDIRECT || RENDER_NORMALS
+			cubeInstanceBuffer.upload(visibleCubeInstances.data(), visibleCubeInstances.size());
+			#endif
+		}
+		#endif
+
+		// queue the cubes: all cubes draw before all normal lines regardless of submission order
+		if(instanced_rendering)
+		{
+			#if MULTI_DRAW_INDIRECT
+			// the cubes are the batch's first command, the normal lines still read cubeInstanceBuffer
+			litBatch.add(cubeRange, FRUSTUM_CULLING ? visibleCubeInstances.data() : cubeInstances.data(), FRUSTUM_CULLING ? visibleCubeInstances.size() : cubeInstances.size());
+			#endif
+			// one draw call for every visible cube, transforms come from cubeInstanceBuffer
+			if(cubeInstanceBuffer.size() > 0)
+			{
+				#if !MULTI_DRAW_INDIRECT
+				cubeDraw.instance_count = (GLsizei)cubeInstanceBuffer.size();
+				renderQueue.submit(PASS_OPAQUE, cubeDraw);
+				#endif
+				#if RENDER_NORMALS
+				normalLinesDraw.instance_count = (GLsizei)cubeInstanceBuffer.size();
+				renderQueue.submit(PASS_DEBUG_LINES, normalLinesDraw);
+				#endif
+			}
+		}
+		else
+		{
+			for(size_t v = 0; v < visibleCubeCount; v++)
+			{
+				size_t i = visibleCubes[v];
+				float depth = glm::length(camera.position - cubePositions[i]) / 100.0f;
+				cubeDraw.model = cubeInstances[i].model;
+				cubeDraw.normalMat = cubeInstances[i].normalMat;
+				cubeDraw.layer = (int)cubeInstances[i].layer;
+				renderQueue.submit(PASS_OPAQUE, cubeDraw, depth);
+
+				// render normal lines visually
+				#if RENDER_NORMALS 
+				normalLinesDraw.model = cubeInstances[i].model;
+				renderQueue.submit(PASS_DEBUG_LINES, normalLinesDraw, depth);
+				#endif
+			}
+		}
+
+		#if RENDER_SPHERES
+		for(int i = 0; i < 8; i++)
+		{
+			glm::vec3 center(4.0f, 0.0f, -6.0f * i);
+			float sphereRadius = 1.0f;
+			float distance = glm::length(camera.position - center);
+			int lod = select_lod(sphereRadius, distance, glm::radians(camera.fov), (float)SCREEN_HEIGHT, SPHERE_LODS);
+			submit_surface(sphereLods[lod], glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(sphereRadius)), i, distance / 100.0f);
+		}
+		#endif
+
+		#if RENDER_CONES
+		for(size_t c = 0; c < coneModels.size(); c++)
+		{
+			const glm::mat4& coneModel = coneModels[c];
+			glm::vec3 center(coneModel[3]);
+			float coneRadius = glm::max(glm::length(glm::vec3(coneModel[0])), 0.5f * glm::length(glm::vec3(coneModel[1])));
+			float distance = glm::length(camera.position - center);
+			int lod = select_lod(coneRadius, distance, glm::radians(camera.fov), (float)SCREEN_HEIGHT, CONE_LODS);
+			submit_surface(coneLods[lod], coneModel, (int)c, distance / 100.0f);
+		}
+		#endif
+
+		#if MULTI_DRAW_INDIRECT
+		// everything lit and instanced so far in one queued draw
+		if(litBatch.size() > 0)
+		{
+			litBatch.upload();
+			DrawCommand batchDraw = batch_draw_command(surfaceShader, meshArena, litBatch);
+			apply_material(batchDraw, 0);
+			renderQueue.submit(PASS_OPAQUE, batchDraw);
+		}
+		#endif
+
+		#if RENDER_SIERPINSKI
+		DrawCommand sierpinskiDraw = mesh_draw_command(sierpinskiShader, meshArena, sierpinskiRange);
+		sierpinskiDraw.instance_count = (GLsizei)sierpinskiTransforms.size();
+		renderQueue.submit(PASS_OPAQUE, sierpinskiDraw);
+		#endif
+
+		#if STREAM_TEXTURES && !MATERIAL_ARRAYS
+		// the cube texture covers a whole face, so its on-screen size is the cube's
+		if(streamedDiffuse.valid() && streamedSpecular.valid())
+		{
+			for(const glm::vec3& position : cubePositions)
+			{
+				float pixels = projected_pixels(0.87f, glm::length(camera.position - position), glm::radians(camera.fov), (float)SCREEN_HEIGHT);
+				textureStreamer.request(streamedDiffuse, pixels);
+				textureStreamer.request(streamedSpecular, pixels);
+			}
 		}
+		textureStreamer.update();
+		#endif
 
-		colorObjShader.setVec3("viewPos", camera.position);
+		if(deferred_shading)
+		{
+			// opaque surfaces into the G-buffer, then one lighting pass; debug lines stay forward on top
+			gbuffer.resize(framebufferWidth, framebufferHeight);
+			gbuffer.begin_geometry();
+			renderQueue.flush_through(PASS_OPAQUE);
+			gbuffer.light(deferredLightShader);
+		}
+		renderQueue.flush();
 		
 		// now render the light source cube
 		// lightSrcShader.use();
-		// lightSrcShader.setMat4("projection", projection);
-		// lightSrcShader.setMat4("view", view);
 		// model = glm::mat4(1.0f);
 		// model = glm::translate(model, lightPos);
 		// model = glm::scale(model, glm::vec3(0.2f));
 		// lightSrcShader.setMat4("model", model);
 		
 		// glBindVertexArray(lightCubeVAO);
-		// glDrawArrays(GL_TRIANGLES, 0, 36);
+		// glDrawElementsBaseVertex(GL_TRIANGLES, cubeRange.index_count, MeshArena::index_type, (void*)(cubeRange.first_index * sizeof(uint32_t)), cubeRange.base_vertex);
 
 
 		// ImGui render
@@ -352,9 +819,32 @@ int main()
 	} 
 
 	// de-allocate and clean-up
-	glDeleteVertexArrays(1, &colorCubeVAO);
+	meshArena.destroy();
+	#if MULTI_DRAW_INDIRECT
+	litBatch.destroy();
+	#endif
 	glDeleteVertexArrays(1, &lightCubeVAO);
-	glDeleteBuffers(1, &VBO);
+	cubeInstanceBuffer.destroy();
+	cameraUniforms.destroy();
+	gbuffer.destroy();
+	#if CLUSTERED_LIGHTS
+	lightClusters.destroy();
+	#else
+	lightUniforms.destroy();
+	#endif
+	textureManager.release(diffuseMap);
+	textureManager.release(specularMap);
+	textureManager.destroy();
+	#if MATERIAL_ARRAYS
+	materials.destroy();
+	#elif STREAM_TEXTURES
+	textureStreamer.destroy();
+	#endif
+	textureLoader.destroy();
+	texturePack.close();
+	#if RENDER_SIERPINSKI
+	glDeleteBuffers(1, &sierpinskiInstanceVBO);
+	#endif
 	#if UI_ENABLED
 		ImGui_ImplOpenGL3_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -401,9 +891,9 @@ void process_input(GLFWwindow* window)
 
 	// Line mode Toggle
 	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		gl_state().polygon_mode(GL_LINE);
 	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		gl_state().polygon_mode(GL_FILL);
 
 	// Movement
 	if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -428,99 +918,29 @@ void scroll_callback(GLFWwindow* window, double x_offset, double y_offset)
 	camera.process_mouse_scroll(static_cast<float>(y_offset));
 }
 
-// Draws a sierpinski triangle to specified degree of depth
-void draw_sierpinski(Shader& shader, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree)
+// one-shot toggles (held keys are handled in process_input)
+void key_callback(GLFWwindow*, int key, int, int action, int)
 {
-	std::vector<float> vertices;
-	
-	// lamnda func to add tri to vertex list
-	auto add_triangle = [&vertices](glm::vec3 v1, glm::vec3 v2, glm::vec3 v3)
-	{
-		vertices.push_back(v1.x); vertices.push_back(v1.y); vertices.push_back(v1.z);	vertices.push_back(1); vertices.push_back(0); vertices.push_back(0);  // RED
-		vertices.push_back(v2.x); vertices.push_back(v2.y); vertices.push_back(v2.z);	vertices.push_back(0); vertices.push_back(1); vertices.push_back(0);  // GREEN
-		vertices.push_back(v3.x); vertices.push_back(v3.y); vertices.push_back(v3.z);	vertices.push_back(0); vertices.push_back(0); vertices.push_back(1);  // BLUE
-	};
-
-	// use a stack to handle tri's iteratively
-	std::stack<std::tuple<glm::vec3, glm::vec3, glm::vec3, int>> stack;
-	stack.push({v1, v2, v3, degree});
-
-	while(!stack.empty())
-	{
-		auto [v1, v2, v3, depth] = stack.top();
-		stack.pop();
-
-		if(depth == 0)
-		{
-			add_triangle(v1, v2, v3);
-		}
-		else 
-		{
-			glm::vec3 mid1 = 0.5f * (v1 + v2);
-			glm::vec3 mid2 = 0.5f * (v2 + v3);
-			glm::vec3 mid3 = 0.5f * (v1 + v3);
-
-			// push the 3 smaller tris to the stack
-			stack.push({v1, mid1, mid3, depth - 1});
-			stack.push({mid1, v2, mid2, depth - 1});
-			stack.push({mid3, mid2, v3, depth - 1});
-		}
-	}
-
-	unsigned int VBO, VAO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	shader.use();
-	glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 6);
-
-	// cleanup
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	if(action != GLFW_PRESS)
+		return;
+
+	// instanced vs one draw call per cube
+	if(key == GLFW_KEY_I)
+		instanced_rendering = !instanced_rendering;
+	// forward vs deferred shading
+	if(key == GLFW_KEY_G)
+		deferred_shading = !deferred_shading;
+	if(key == GLFW_KEY_P)
+		pick_requested = true;
+	// one multi-draw-indirect call vs a draw per indirect command
+	if(key == GLFW_KEY_M)
+		multi_draw_indirect = !multi_draw_indirect;
 }
 
-// loads and formats a 2D texture from file
-unsigned int loadTexture(char const* path)
+// Draws a sierpinski triangle to specified degree of depth. Geometry is cached in mesh and only rebuilt when the params change.
+void draw_sierpinski(SierpinskiMesh& mesh, Shader& shader, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	
-	int width, height, nComponents;
-	unsigned char *data = stbi_load(path, &width, &height, &nComponents, 0);
-	if(data) // exists
-	{
-		GLenum format;
-		if(nComponents == 1)
-			format = GL_RED;
-		else if(nComponents == 3)
-			format = GL_RGB;
-		else if(nComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-	}
-
-	return textureID;
+	mesh.update(v1, v2, v3, degree);
+	shader.use();
+	mesh.draw();
 }
\ No newline at end of file
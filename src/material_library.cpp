@@ -0,0 +1,127 @@
+#include "MaterialLibrary.hpp"
+#include "MipGenerator.hpp"
+#include "GLState.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+namespace
+{
+    // any channel count -> RGBA8 at the target size, bilinear when the size differs
+    std::vector<unsigned char> to_rgba(const unsigned char* pixels, int width, int height, int channels, int out_width, int out_height)
+    {
+        std::vector<unsigned char> rgba((size_t)out_width * out_height * 4);
+        auto fetch = [&](int x, int y, int c) -> float
+        {
+            const unsigned char* p = pixels + ((size_t)y * width + x) * channels;
+            if(c == 3)
+                return (channels == 2 || channels == 4) ? p[channels - 1] : 255.0f;
+            return channels <= 2 ? p[0] : p[c];
+        };
+        for(int y = 0; y < out_height; y++)
+        {
+            float sy = std::max(0.0f, (y + 0.5f) * height / out_height - 0.5f);
+            int y0 = std::min((int)sy, height - 1), y1 = std::min(y0 + 1, height - 1);
+            float fy = sy - y0;
+            for(int x = 0; x < out_width; x++)
+            {
+                float sx = std::max(0.0f, (x + 0.5f) * width / out_width - 0.5f);
+                int x0 = std::min((int)sx, width - 1), x1 = std::min(x0 + 1, width - 1);
+                float fx = sx - x0;
+                for(int c = 0; c < 4; c++)
+                {
+                    float top = fetch(x0, y0, c) * (1.0f - fx) + fetch(x1, y0, c) * fx;
+                    float bottom = fetch(x0, y1, c) * (1.0f - fx) + fetch(x1, y1, c) * fx;
+                    rgba[((size_t)y * out_width + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+                }
+            }
+        }
+        return rgba;
+    }
+}
+
+TextureArray::TextureArray(int width, int height, int max_layers, bool srgb)
+    : width(width), height(height), levels(1), capacity(max_layers), srgb(srgb), count(0)
+{
+    while((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+
+    // no glTexStorage3D in 3.3: allocate every level for every layer up front
+    glGenTextures(1, &ID);
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D_ARRAY, ID);
+    for(int level = 0; level < levels; level++)
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(1, width >> level), std::max(1, height >> level), capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+int TextureArray::add_layer(const unsigned char* pixels, int image_width, int image_height, int channels)
+{
+    if(count >= capacity)
+    {
+        std::cout << "ERROR::TEXTURE_ARRAY::FULL (" << capacity << " layers)" << std::endl;
+        return -1;
+    }
+    std::vector<unsigned char> base = to_rgba(pixels, image_width, image_height, channels, width, height);
+    MipOptions options;
+    options.srgb = srgb;
+    options.max_levels = levels;
+    std::vector<MipLevel> mips = generate_mips(base.data(), width, height, 4, options);
+
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D_ARRAY, ID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, count, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, base.data());
+    for(size_t i = 0; i < mips.size(); i++)
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i + 1, 0, 0, count, mips[i].width, mips[i].height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mips[i].pixels.data());
+    return count++;
+}
+
+void TextureArray::destroy()
+{
+    gl_state().forget_texture(ID);
+    glDeleteTextures(1, &ID);
+    ID = 0;
+    count = 0;
+}
+
+MaterialLibrary::MaterialLibrary(int size, int max_materials)
+    : diffuse(size, size, max_materials), specular(size, size, max_materials, false) {}
+
+int MaterialLibrary::add(const std::string& diffuse_path, const std::string& specular_path, float default_specular)
+{
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(diffuse_path.c_str(), &width, &height, &channels, 0);
+    if(!pixels)
+    {
+        std::cout << "Texture failed to load at path: " << diffuse_path << std::endl;
+        return -1;
+    }
+    int layer = diffuse.add_layer(pixels, width, height, channels);
+    stbi_image_free(pixels);
+    if(layer < 0)
+        return -1;
+
+    pixels = specular_path.empty() ? nullptr : stbi_load(specular_path.c_str(), &width, &height, &channels, 0);
+    if(pixels)
+    {
+        specular.add_layer(pixels, width, height, channels);
+        stbi_image_free(pixels);
+    }
+    else
+    {
+        if(!specular_path.empty())
+            std::cout << "Texture failed to load at path: " << specular_path << std::endl;
+        unsigned char flat = (unsigned char)(std::min(std::max(default_specular, 0.0f), 1.0f) * 255.0f + 0.5f);
+        specular.add_layer(&flat, 1, 1, 1);
+    }
+    return layer;
+}
+
+void MaterialLibrary::destroy()
+{
+    diffuse.destroy();
+    specular.destroy();
+}
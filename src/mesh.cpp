@@ -0,0 +1,346 @@
+#include "Mesh.hpp"
+#include "GLState.hpp"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    const uint32_t EMPTY = ~0u;
+
+    // Forsyth scoring constants
+    const int OPT_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRI_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    float vertex_score(int cache_pos, int active_tris)
+    {
+        if(active_tris == 0) // no triangles left to use it, never worth picking for
+            return -1.0f;
+
+        float score = 0.0f;
+        if(cache_pos >= 0)
+        {
+            if(cache_pos < 3) // used by the last triangle, fixed score so the last tri's vertices don't win outright
+                score = LAST_TRI_SCORE;
+            else
+                score = std::pow(1.0f - (cache_pos - 3) / float(OPT_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        // boost vertices with few triangles left so they get finished off instead of lingering
+        score += VALENCE_BOOST_SCALE * std::pow(float(active_tris), -VALENCE_BOOST_POWER);
+        return score;
+    }
+}
+
+float compute_acmr(const std::vector<uint32_t>& indices, size_t n_vertices, int cache_size)
+{
+    if(indices.size() < 3)
+        return 0.0f;
+
+    // FIFO cache: a vertex is in the cache if fewer than cache_size misses came after the one that inserted it.
+    // inserted_at is that miss's 1-based number, 0 for never inserted.
+    std::vector<size_t> inserted_at(n_vertices, 0);
+    size_t misses = 0;
+    for(uint32_t index : indices)
+    {
+        if(inserted_at[index] == 0 || misses - inserted_at[index] >= (size_t)cache_size)
+        {
+            misses++;
+            inserted_at[index] = misses;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t n_vertices)
+{
+    const size_t n_tris = indices.size() / 3;
+    if(n_tris == 0)
+        return;
+
+    // vertex -> triangle adjacency (CSR). The first active_tris[v] entries of a vertex's range are the unemitted ones.
+    std::vector<int> active_tris(n_vertices, 0);
+    for(uint32_t index : indices)
+        active_tris[index]++;
+    std::vector<uint32_t> adjacency_offset(n_vertices + 1, 0);
+    for(size_t v = 0; v < n_vertices; v++)
+        adjacency_offset[v + 1] = adjacency_offset[v] + active_tris[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+        for(size_t t = 0; t < n_tris; t++)
+            for(int c = 0; c < 3; c++)
+                adjacency[fill[indices[t * 3 + c]]++] = (uint32_t)t;
+    }
+
+    std::vector<int> cache_pos(n_vertices, -1);
+    std::vector<float> vert_score(n_vertices);
+    for(size_t v = 0; v < n_vertices; v++)
+        vert_score[v] = vertex_score(-1, active_tris[v]);
+
+    std::vector<float> tri_score(n_tris);
+    std::vector<bool> tri_emitted(n_tris, false);
+    for(size_t t = 0; t < n_tris; t++)
+        tri_score[t] = vert_score[indices[t * 3]] + vert_score[indices[t * 3 + 1]] + vert_score[indices[t * 3 + 2]];
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<uint32_t> cache, new_cache;
+    cache.reserve(OPT_CACHE_SIZE + 3);
+    new_cache.reserve(OPT_CACHE_SIZE + 3);
+
+    long best_tri = (long)(std::max_element(tri_score.begin(), tri_score.end()) - tri_score.begin());
+    size_t scan_cursor = 0;
+    for(size_t emitted = 0; emitted < n_tris; emitted++)
+    {
+        if(best_tri < 0) // nothing in the cache touches a live triangle, fall back to the next unemitted one
+        {
+            while(tri_emitted[scan_cursor])
+                scan_cursor++;
+            best_tri = (long)scan_cursor;
+        }
+
+        const uint32_t* tri = &indices[best_tri * 3];
+        tri_emitted[best_tri] = true;
+        new_cache.assign(tri, tri + 3);
+        for(int c = 0; c < 3; c++)
+        {
+            uint32_t v = tri[c];
+            output.push_back(v);
+
+            // drop the triangle from v's active range
+            uint32_t* first = &adjacency[adjacency_offset[v]];
+            uint32_t* last = first + active_tris[v] - 1;
+            std::swap(*std::find(first, last + 1, (uint32_t)best_tri), *last);
+            active_tris[v]--;
+        }
+
+        // emitted vertices move to the front of the LRU cache
+        for(uint32_t v : cache)
+            if(v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache.push_back(v);
+        for(size_t i = OPT_CACHE_SIZE; i < new_cache.size(); i++)
+        {
+            cache_pos[new_cache[i]] = -1;
+            vert_score[new_cache[i]] = vertex_score(-1, active_tris[new_cache[i]]);
+        }
+        if(new_cache.size() > (size_t)OPT_CACHE_SIZE)
+            new_cache.resize(OPT_CACHE_SIZE);
+        std::swap(cache, new_cache);
+
+        // rescore cached vertices and their triangles, remembering the best candidate
+        for(size_t i = 0; i < cache.size(); i++)
+        {
+            cache_pos[cache[i]] = (int)i;
+            vert_score[cache[i]] = vertex_score((int)i, active_tris[cache[i]]);
+        }
+        best_tri = -1;
+        float best_score = -1.0f;
+        for(uint32_t v : cache)
+        {
+            for(int a = 0; a < active_tris[v]; a++)
+            {
+                uint32_t t = adjacency[adjacency_offset[v] + a];
+                float score = vert_score[indices[t * 3]] + vert_score[indices[t * 3 + 1]] + vert_score[indices[t * 3 + 2]];
+                tri_score[t] = score;
+                if(score > best_score)
+                {
+                    best_score = score;
+                    best_tri = (long)t;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimize_vertex_fetch(MeshData& mesh)
+{
+    std::vector<uint32_t> remap(mesh.vertices.size(), EMPTY);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for(uint32_t& index : mesh.indices)
+    {
+        if(remap[index] == EMPTY)
+        {
+            remap[index] = (uint32_t)vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices); // unreferenced vertices are dropped
+}
+
+int select_lod(float radius, float distance, float fovY, float screenHeight, int nLevels, float fullDetailPixels)
+{
+    if(distance <= radius)
+        return 0;
+    float projectedPixels = radius * screenHeight / (distance * std::tan(fovY * 0.5f));
+    int level = (int)std::floor(std::log2(fullDetailPixels / projectedPixels));
+    return std::clamp(level, 0, nLevels - 1);
+}
+
+size_t MeshBuilder::VertexHash::operator()(const Vertex& v) const
+{
+    // FNV-1a over the raw bits, so only bit-identical vertices weld
+    uint32_t words[8];
+    std::memcpy(words, &v, sizeof(words));
+    uint64_t hash = 14695981039346656037ull;
+    for(uint32_t word : words)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+bool MeshBuilder::VertexEqual::operator()(const Vertex& a, const Vertex& b) const
+{
+    return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+}
+
+MeshBuilder::MeshBuilder()
+    : acmr_before(0.0f), acmr_after(0.0f), weld_table(64, EMPTY) {}
+
+void MeshBuilder::reserve(size_t n_vertices, size_t n_indices)
+{
+    mesh.vertices.reserve(n_vertices);
+    mesh.indices.reserve(n_indices);
+    while(weld_table.size() < n_vertices * 2)
+        grow_weld_table();
+}
+
+uint32_t MeshBuilder::add_vertex(const Vertex& v)
+{
+    if(mesh.vertices.size() * 2 >= weld_table.size()) // keep load factor under 1/2
+        grow_weld_table();
+
+    size_t mask = weld_table.size() - 1;
+    for(size_t slot = VertexHash()(v) & mask; ; slot = (slot + 1) & mask)
+    {
+        uint32_t existing = weld_table[slot];
+        if(existing == EMPTY)
+        {
+            weld_table[slot] = (uint32_t)mesh.vertices.size();
+            mesh.vertices.push_back(v);
+            return weld_table[slot];
+        }
+        if(VertexEqual()(mesh.vertices[existing], v))
+            return existing;
+    }
+}
+
+void MeshBuilder::add_triangle(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    mesh.indices.push_back(i0);
+    mesh.indices.push_back(i1);
+    mesh.indices.push_back(i2);
+}
+
+void MeshBuilder::add_triangles(const float* interleaved, size_t n_vertices)
+{
+    for(size_t i = 0; i < n_vertices; i++)
+    {
+        const float* f = interleaved + i * 8;
+        Vertex v = { glm::vec3(f[0], f[1], f[2]), glm::vec3(f[3], f[4], f[5]), glm::vec2(f[6], f[7]) };
+        mesh.indices.push_back(add_vertex(v));
+    }
+}
+
+void MeshBuilder::add_indexed(const MeshData& data)
+{
+    std::vector<uint32_t> remap(data.vertices.size());
+    for(size_t i = 0; i < data.vertices.size(); i++)
+        remap[i] = add_vertex(data.vertices[i]);
+    for(uint32_t index : data.indices)
+        mesh.indices.push_back(remap[index]);
+}
+
+MeshData MeshBuilder::build(bool optimize)
+{
+    acmr_before = compute_acmr(mesh.indices, mesh.vertices.size());
+    if(optimize)
+    {
+        optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+        optimize_vertex_fetch(mesh);
+    }
+    acmr_after = compute_acmr(mesh.indices, mesh.vertices.size());
+
+    MeshData result;
+    result.vertices.swap(mesh.vertices);
+    result.indices.swap(mesh.indices);
+    std::fill(weld_table.begin(), weld_table.end(), EMPTY);
+    return result;
+}
+
+void MeshBuilder::grow_weld_table()
+{
+    weld_table.assign(weld_table.size() * 2, EMPTY);
+    size_t mask = weld_table.size() - 1;
+    for(uint32_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        size_t slot = VertexHash()(mesh.vertices[i]) & mask;
+        while(weld_table[slot] != EMPTY)
+            slot = (slot + 1) & mask;
+        weld_table[slot] = i;
+    }
+}
+
+Mesh::Mesh(const MeshData& data)
+    : index_count((GLsizei)data.indices.size()), vertex_count((GLsizei)data.vertices.size())
+{
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    gl_state().bind_vertex_array(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(Vertex), data.vertices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if(data.uses_16bit_indices())
+    {
+        std::vector<uint16_t> indices16(data.indices.begin(), data.indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices16.size() * sizeof(uint16_t), indices16.data(), GL_STATIC_DRAW);
+        index_type = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(uint32_t), data.indices.data(), GL_STATIC_DRAW);
+        index_type = GL_UNSIGNED_INT;
+    }
+
+    // pos attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    // normal attribute
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+    // texture coord attribute
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tex_coords));
+    glEnableVertexAttribArray(2);
+    gl_state().bind_vertex_array(0);
+}
+
+void Mesh::draw(GLenum mode) const
+{
+    gl_state().bind_vertex_array(VAO);
+    glDrawElements(mode, index_count, index_type, (void*)0);
+}
+
+void Mesh::draw_instanced(GLsizei instance_count, GLenum mode) const
+{
+    gl_state().bind_vertex_array(VAO);
+    glDrawElementsInstanced(mode, index_count, index_type, (void*)0, instance_count);
+}
+
+void Mesh::destroy()
+{
+    gl_state().forget_vertex_array(VAO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
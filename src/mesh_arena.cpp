@@ -0,0 +1,170 @@
+#include "MeshArena.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <iostream>
+
+size_t vertex_stride(VertexFormat format)
+{
+    switch(format)
+    {
+    case FORMAT_LIT: return sizeof(Vertex);
+    case FORMAT_POSITION: return 3 * sizeof(float);
+    case FORMAT_COLORED: return 6 * sizeof(float);
+    default: return 0;
+    }
+}
+
+MeshArena::MeshArena(size_t vertex_capacity, size_t index_capacity)
+    : indices((uint32_t)index_capacity)
+{
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+
+    for(int f = 0; f < N_VERTEX_FORMATS; f++)
+    {
+        FormatBuffer& buffer = buffers[f];
+        GLsizei stride = (GLsizei)vertex_stride((VertexFormat)f);
+        buffer.allocator = OffsetAllocator((uint32_t)vertex_capacity);
+        glGenVertexArrays(1, &buffer.VAO);
+        glGenBuffers(1, &buffer.VBO);
+        gl_state().bind_vertex_array(buffer.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertex_capacity * stride, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        // pos attribute, first in every format
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(0);
+        if(f == FORMAT_LIT)
+        {
+            // normal attribute
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal));
+            glEnableVertexAttribArray(1);
+            // texture coord attribute
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, tex_coords));
+            glEnableVertexAttribArray(2);
+        }
+        else if(f == FORMAT_COLORED)
+        {
+            // color attribute
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+        }
+    }
+    gl_state().bind_vertex_array(0);
+}
+
+MeshRange MeshArena::add(VertexFormat format, const void* vertices, size_t vertex_count, const uint32_t* index_data, size_t index_count)
+{
+    MeshRange range;
+    range.format = format;
+    if(vertex_count == 0)
+        return range;
+
+    FormatBuffer& buffer = buffers[format];
+    size_t stride = vertex_stride(format);
+    range.vertex_block = allocate(buffer.allocator, buffer.VBO, stride, (uint32_t)vertex_count);
+    if(!range.vertex_block.valid())
+    {
+        std::cout << "ERROR::MESH_ARENA::no room for " << vertex_count << " vertices" << std::endl;
+        return MeshRange();
+    }
+    range.vertex_count = (uint32_t)vertex_count;
+    range.base_vertex = (int32_t)range.vertex_block.offset;
+    // the copy targets leave every VAO's element buffer binding alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.vertex_block.offset * stride, vertex_count * stride, vertices);
+
+    if(index_count > 0)
+    {
+        range.index_block = allocate(indices, EBO, sizeof(uint32_t), (uint32_t)index_count);
+        if(!range.index_block.valid())
+        {
+            std::cout << "ERROR::MESH_ARENA::no room for " << index_count << " indices" << std::endl;
+            free(range);
+            return range;
+        }
+        range.first_index = range.index_block.offset;
+        range.index_count = (uint32_t)index_count;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.first_index * sizeof(uint32_t), index_count * sizeof(uint32_t), index_data);
+    }
+    return range;
+}
+
+MeshRange MeshArena::add(const MeshData& mesh)
+{
+    return add(FORMAT_LIT, mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+}
+
+void MeshArena::free(MeshRange& range)
+{
+    buffers[range.format].allocator.free(range.vertex_block);
+    indices.free(range.index_block);
+    range = MeshRange();
+}
+
+void MeshArena::print_report() const
+{
+    auto report = [](const char* name, const OffsetAllocator::Stats& stats)
+    {
+        std::cout << "MESH_ARENA::" << name << " " << (stats.size - stats.free) << " / " << stats.size << " used in "
+                  << stats.allocations << " ranges, " << stats.free_blocks << " free blocks, largest " << stats.largest_free
+                  << ", fragmentation " << (int)(100.0f * stats.fragmentation()) << "%" << std::endl;
+    };
+    static const char* names[N_VERTEX_FORMATS] = { "LIT", "POSITION", "COLORED" };
+    for(int f = 0; f < N_VERTEX_FORMATS; f++)
+        report(names[f], vertex_stats((VertexFormat)f));
+    report("INDICES", index_stats());
+}
+
+OffsetAllocator::Allocation MeshArena::allocate(OffsetAllocator& allocator, unsigned int buffer, size_t element_size, uint32_t count)
+{
+    OffsetAllocator::Allocation allocation = allocator.allocate(count);
+    // full (or too fragmented): double the buffer, the new space joins a free block at the end. allocate() rounds
+    // the request up to a size class, so a block of exactly count may still not be enough and it takes another round.
+    while(!allocation.valid())
+    {
+        uint64_t old_size = allocator.size();
+        uint64_t new_size = std::max(old_size * 2, old_size + count);
+        if(new_size > 0xFFFFFFFFull)
+            return allocation;
+        grow(buffer, (size_t)old_size * element_size, (size_t)new_size * element_size);
+        allocator.grow((uint32_t)new_size);
+        allocation = allocator.allocate(count);
+    }
+    return allocation;
+}
+
+void MeshArena::grow(unsigned int buffer, size_t used, size_t new_size)
+{
+    // round trip through a scratch buffer so the name (and every VAO pointing at it) stays valid
+    unsigned int scratch;
+    glGenBuffers(1, &scratch);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+    glBufferData(GL_COPY_WRITE_BUFFER, used, NULL, GL_STREAM_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    if(used > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_size, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+    if(used > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+    glDeleteBuffers(1, &scratch);
+}
+
+void MeshArena::destroy()
+{
+    for(FormatBuffer& buffer : buffers)
+    {
+        gl_state().forget_vertex_array(buffer.VAO);
+        glDeleteVertexArrays(1, &buffer.VAO);
+        glDeleteBuffers(1, &buffer.VBO);
+        buffer.allocator = OffsetAllocator();
+    }
+    glDeleteBuffers(1, &EBO);
+    indices = OffsetAllocator();
+}
@@ -0,0 +1,289 @@
+#include "MipGenerator.hpp"
+#include "Parallel.hpp"
+#include <emmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // linear float4 image, r g b a per texel
+    struct FloatImage
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> texels;
+    };
+
+    // source taps for one destination texel when halving: source index = 2 * x + first + k
+    struct Kernel
+    {
+        int first;
+        std::vector<float> weights;
+    };
+
+    struct SrgbTables
+    {
+        float to_linear[256];
+        unsigned char to_srgb[4096]; // indexed by linear quantized to 12 bits, fine enough that no two bytes collapse
+
+        SrgbTables()
+        {
+            for(int i = 0; i < 256; i++)
+            {
+                double c = i / 255.0;
+                to_linear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+            }
+            for(int i = 0; i < 4096; i++)
+            {
+                double c = i / 4095.0;
+                double s = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+                to_srgb[i] = (unsigned char)std::lround(std::min(std::max(s, 0.0), 1.0) * 255.0);
+            }
+        }
+    };
+
+    // built once, on first use from whichever thread gets there first
+    const SrgbTables& srgb_tables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    double sinc(double x)
+    {
+        if(std::fabs(x) < 1e-6)
+            return 1.0;
+        return std::sin(PI * x) / (PI * x);
+    }
+
+    // zeroth order modified Bessel function of the first kind, for the Kaiser window
+    double bessel_i0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for(int k = 1; k < 32; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    Kernel make_kernel(MipFilter filter)
+    {
+        Kernel kernel;
+        if(filter == MIP_FILTER_BOX)
+        {
+            kernel.first = 0;
+            kernel.weights = { 0.5f, 0.5f };
+            return kernel;
+        }
+
+        // windowed sinc, radius in destination texels; the destination center sits between source texels 2x and 2x+1
+        const int RADIUS = 3;
+        const double KAISER_BETA = 4.0;
+        kernel.first = 1 - 2 * RADIUS;
+        double total = 0.0;
+        std::vector<double> weights;
+        for(int k = kernel.first; k <= 2 * RADIUS; k++)
+        {
+            double t = (k - 0.5) / 2.0; // distance from the destination center, in destination texels
+            double window = filter == MIP_FILTER_LANCZOS ? sinc(t / RADIUS)
+                                                         : bessel_i0(KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - (t / RADIUS) * (t / RADIUS)))) / bessel_i0(KAISER_BETA);
+            weights.push_back(sinc(t) * window);
+            total += weights.back();
+        }
+        for(double w : weights)
+            kernel.weights.push_back((float)(w / total));
+        return kernel;
+    }
+
+    // input channel -> float4 slot: grey goes to r, the last channel of 2 / 4 channel images is alpha
+    inline int slot_of(int channel, int channels)
+    {
+        return (channels == 2 && channel == 1) ? 3 : channel;
+    }
+
+    inline bool is_alpha(int channel, int channels)
+    {
+        return (channels == 2 && channel == 1) || (channels == 4 && channel == 3);
+    }
+
+    FloatImage to_linear(const unsigned char* pixels, int width, int height, int channels, bool srgb)
+    {
+        FloatImage image;
+        image.width = width;
+        image.height = height;
+        image.texels.assign((size_t)width * height * 4, 0.0f);
+        const float* decode = srgb_tables().to_linear;
+        parallel_for(0, height, [&](size_t row_begin, size_t row_end)
+        {
+            for(size_t y = row_begin; y < row_end; y++)
+            {
+                for(int x = 0; x < width; x++)
+                {
+                    const unsigned char* src = pixels + (y * width + x) * channels;
+                    float* dst = &image.texels[(y * width + x) * 4];
+                    dst[3] = 1.0f;
+                    for(int c = 0; c < channels; c++)
+                        dst[slot_of(c, channels)] = (srgb && !is_alpha(c, channels)) ? decode[src[c]] : src[c] / 255.0f;
+                }
+            }
+        }, 16);
+        return image;
+    }
+
+    void to_bytes(const FloatImage& image, int channels, bool srgb, float alpha_scale, std::vector<unsigned char>& out)
+    {
+        out.resize((size_t)image.width * image.height * channels);
+        const unsigned char* encode = srgb_tables().to_srgb;
+        parallel_for(0, image.height, [&](size_t row_begin, size_t row_end)
+        {
+            for(size_t y = row_begin; y < row_end; y++)
+            {
+                for(int x = 0; x < image.width; x++)
+                {
+                    const float* src = &image.texels[(y * image.width + x) * 4];
+                    unsigned char* dst = &out[(y * image.width + x) * channels];
+                    for(int c = 0; c < channels; c++)
+                    {
+                        bool alpha = is_alpha(c, channels);
+                        float v = std::min(std::max(src[slot_of(c, channels)] * (alpha ? alpha_scale : 1.0f), 0.0f), 1.0f);
+                        dst[c] = (srgb && !alpha) ? encode[(int)(v * 4095.0f + 0.5f)] : (unsigned char)(v * 255.0f + 0.5f);
+                    }
+                }
+            }
+        }, 16);
+    }
+
+    // halves the width, one __m128 per texel
+    FloatImage downsample_horizontal(const FloatImage& src, const Kernel& kernel)
+    {
+        FloatImage dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = src.height;
+        dst.texels.resize((size_t)dst.width * dst.height * 4);
+        int n_taps = (int)kernel.weights.size();
+        parallel_for(0, src.height, [&](size_t row_begin, size_t row_end)
+        {
+            for(size_t y = row_begin; y < row_end; y++)
+            {
+                const float* row = &src.texels[y * src.width * 4];
+                float* out = &dst.texels[y * dst.width * 4];
+                for(int x = 0; x < dst.width; x++)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for(int k = 0; k < n_taps; k++)
+                    {
+                        int sx = std::min(std::max(2 * x + kernel.first + k, 0), src.width - 1);
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + sx * 4), _mm_set1_ps(kernel.weights[k])));
+                    }
+                    _mm_storeu_ps(out + x * 4, sum);
+                }
+            }
+        }, 8);
+        return dst;
+    }
+
+    // halves the height, whole rows at a time (two texels per AVX register, one per SSE register)
+    FloatImage downsample_vertical(const FloatImage& src, const Kernel& kernel)
+    {
+        FloatImage dst;
+        dst.width = src.width;
+        dst.height = std::max(1, src.height / 2);
+        dst.texels.resize((size_t)dst.width * dst.height * 4);
+        int n_taps = (int)kernel.weights.size();
+        size_t row_floats = (size_t)src.width * 4;
+        parallel_for(0, dst.height, [&](size_t row_begin, size_t row_end)
+        {
+            std::vector<const float*> rows(n_taps);
+            for(size_t y = row_begin; y < row_end; y++)
+            {
+                for(int k = 0; k < n_taps; k++)
+                    rows[k] = &src.texels[std::min(std::max(2 * (int)y + kernel.first + k, 0), src.height - 1) * row_floats];
+                float* out = &dst.texels[y * row_floats];
+                size_t i = 0;
+                #ifdef __AVX__
+                for(; i + 8 <= row_floats; i += 8)
+                {
+                    __m256 sum = _mm256_setzero_ps();
+                    for(int k = 0; k < n_taps; k++)
+                        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(kernel.weights[k])));
+                    _mm256_storeu_ps(out + i, sum);
+                }
+                #endif
+                for(; i < row_floats; i += 4)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for(int k = 0; k < n_taps; k++)
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(kernel.weights[k])));
+                    _mm_storeu_ps(out + i, sum);
+                }
+            }
+        }, 8);
+        return dst;
+    }
+
+    float alpha_coverage(const FloatImage& image, float cutoff, float scale)
+    {
+        size_t n = (size_t)image.width * image.height, passing = 0;
+        for(size_t i = 0; i < n; i++)
+            passing += image.texels[i * 4 + 3] * scale >= cutoff;
+        return (float)passing / n;
+    }
+
+    // alpha scale that brings the level's coverage back to the base level's
+    float coverage_scale(const FloatImage& image, float cutoff, float target)
+    {
+        float lo = 0.0f, hi = 4.0f;
+        for(int i = 0; i < 12; i++)
+        {
+            float scale = 0.5f * (lo + hi);
+            if(alpha_coverage(image, cutoff, scale) > target)
+                hi = scale;
+            else
+                lo = scale;
+        }
+        // coverage is a step function on small levels, take whichever side of the step lands closer
+        float below = alpha_coverage(image, cutoff, lo), above = alpha_coverage(image, cutoff, hi);
+        return target - below <= above - target ? lo : hi;
+    }
+}
+
+std::vector<MipLevel> generate_mips(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    Kernel kernel = make_kernel(options.filter);
+    FloatImage current = to_linear(pixels, width, height, channels, options.srgb);
+    bool has_alpha = channels == 2 || channels == 4;
+    float target_coverage = (has_alpha && options.alpha_cutoff > 0.0f) ? alpha_coverage(current, options.alpha_cutoff, 1.0f) : 0.0f;
+
+    while((current.width > 1 || current.height > 1) && (int)levels.size() + 1 < options.max_levels)
+    {
+        if(current.width > 1)
+            current = downsample_horizontal(current, kernel);
+        if(current.height > 1)
+            current = downsample_vertical(current, kernel);
+
+        float alpha_scale = 1.0f;
+        if(has_alpha && options.alpha_cutoff > 0.0f)
+            alpha_scale = coverage_scale(current, options.alpha_cutoff, target_coverage);
+
+        MipLevel level;
+        level.width = current.width;
+        level.height = current.height;
+        to_bytes(current, channels, options.srgb, alpha_scale, level.pixels);
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+const char* mip_filter_name(MipFilter filter)
+{
+    static const char* NAMES[] = { "box", "kaiser", "lanczos" };
+    return NAMES[filter];
+}
@@ -0,0 +1,256 @@
+#include "OcclusionCuller.hpp"
+#include "Parallel.hpp"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : occluder_triangles(0), tested(0), occluded(0),
+      size_x(width), size_y(height), tiles_x(width / TILE_WIDTH), tiles_y(height / TILE_HEIGHT),
+      projection_view(1.0f), tile_bins((size_t)(width / TILE_WIDTH) * (height / TILE_HEIGHT))
+{
+    int level_x = width, level_y = height;
+    while(true)
+    {
+        hiz.emplace_back((size_t)level_x * level_y, 1.0f);
+        hiz_size.emplace_back(level_x, level_y);
+        if(level_x == 1 && level_y == 1)
+            break;
+        level_x = std::max(1, (level_x + 1) / 2);
+        level_y = std::max(1, (level_y + 1) / 2);
+    }
+}
+
+void OcclusionCuller::begin(const glm::mat4& projection_view)
+{
+    this->projection_view = projection_view;
+    triangles.clear();
+    for(std::vector<uint32_t>& bin : tile_bins)
+        bin.clear();
+    occluder_triangles = 0;
+    tested = 0;
+    occluded = 0;
+}
+
+void OcclusionCuller::add_occluder(const MeshData& mesh, const glm::mat4& model)
+{
+    glm::mat4 mvp = projection_view * model;
+    for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        glm::vec4 clip[3];
+        for(int v = 0; v < 3; v++)
+            clip[v] = mvp * glm::vec4(mesh.vertices[mesh.indices[i + v]].position, 1.0f);
+
+        // clip against the near plane (z + w >= 0) only, the rest is handled by the screen bounds
+        float distance[3];
+        int inside = 0;
+        for(int v = 0; v < 3; v++)
+        {
+            distance[v] = clip[v].z + clip[v].w;
+            inside += distance[v] >= 0.0f;
+        }
+        if(inside == 0)
+            continue;
+        if(inside == 3)
+        {
+            setup_triangle(clip);
+            continue;
+        }
+        glm::vec4 polygon[4];
+        int n = 0;
+        for(int v = 0; v < 3; v++)
+        {
+            int next = (v + 1) % 3;
+            if(distance[v] >= 0.0f)
+                polygon[n++] = clip[v];
+            if((distance[v] >= 0.0f) != (distance[next] >= 0.0f))
+                polygon[n++] = glm::mix(clip[v], clip[next], distance[v] / (distance[v] - distance[next]));
+        }
+        for(int v = 1; v + 1 < n; v++)
+        {
+            glm::vec4 fan[3] = { polygon[0], polygon[v], polygon[v + 1] };
+            setup_triangle(fan);
+        }
+    }
+}
+
+void OcclusionCuller::setup_triangle(const glm::vec4 clip[3])
+{
+    float x[3], y[3], z[3];
+    for(int v = 0; v < 3; v++)
+    {
+        float inverse_w = 1.0f / std::max(clip[v].w, 1e-6f);
+        x[v] = (clip[v].x * inverse_w * 0.5f + 0.5f) * size_x;
+        y[v] = (clip[v].y * inverse_w * 0.5f + 0.5f) * size_y;
+        z[v] = clip[v].z * inverse_w * 0.5f + 0.5f;
+    }
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if(area <= 0.0f) // back facing or degenerate
+        return;
+
+    RasterTriangle triangle;
+    triangle.min_x = std::max(0, (int)std::floor(std::min({ x[0], x[1], x[2] })));
+    triangle.min_y = std::max(0, (int)std::floor(std::min({ y[0], y[1], y[2] })));
+    triangle.max_x = std::min(size_x - 1, (int)std::ceil(std::max({ x[0], x[1], x[2] })));
+    triangle.max_y = std::min(size_y - 1, (int)std::ceil(std::max({ y[0], y[1], y[2] })));
+    if(triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+        return;
+
+    for(int e = 0; e < 3; e++)
+    {
+        int a = e, b = (e + 1) % 3;
+        triangle.edge_a[e] = y[a] - y[b];
+        triangle.edge_b[e] = x[b] - x[a];
+        triangle.edge_c[e] = x[a] * y[b] - x[b] * y[a];
+    }
+    float dz_dx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    float dz_dy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    triangle.depth_a = dz_dx;
+    triangle.depth_b = dz_dy;
+    triangle.depth_c = z[0] - dz_dx * x[0] - dz_dy * y[0];
+
+    uint32_t index = (uint32_t)triangles.size();
+    triangles.push_back(triangle);
+    occluder_triangles++;
+    for(int tile_y = triangle.min_y / TILE_HEIGHT; tile_y <= triangle.max_y / TILE_HEIGHT; tile_y++)
+        for(int tile_x = triangle.min_x / TILE_WIDTH; tile_x <= triangle.max_x / TILE_WIDTH; tile_x++)
+            tile_bins[tile_y * tiles_x + tile_x].push_back(index);
+}
+
+void OcclusionCuller::rasterize()
+{
+    std::fill(hiz[0].begin(), hiz[0].end(), 1.0f);
+    // tiles never share pixels, so they rasterize independently
+    parallel_for(0, tile_bins.size(), [&](size_t begin, size_t end)
+    {
+        for(size_t tile = begin; tile < end; tile++)
+            rasterize_tile((int)tile);
+    });
+    build_hiz();
+}
+
+void OcclusionCuller::rasterize_tile(int tile)
+{
+    const int tile_x0 = (tile % tiles_x) * TILE_WIDTH;
+    const int tile_y0 = (tile / tiles_x) * TILE_HEIGHT;
+    float* depth = hiz[0].data();
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); // pixel centers
+    const __m128 zero = _mm_setzero_ps();
+
+    for(uint32_t index : tile_bins[tile])
+    {
+        const RasterTriangle& triangle = triangles[index];
+        int x_begin = std::max(triangle.min_x, tile_x0) & ~3;
+        int x_end = std::min(triangle.max_x, tile_x0 + TILE_WIDTH - 1);
+        int y_begin = std::max(triangle.min_y, tile_y0);
+        int y_end = std::min(triangle.max_y, tile_y0 + TILE_HEIGHT - 1);
+
+        __m128 a0 = _mm_set1_ps(triangle.edge_a[0]), a1 = _mm_set1_ps(triangle.edge_a[1]), a2 = _mm_set1_ps(triangle.edge_a[2]);
+        __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+        for(int y = y_begin; y <= y_end; y++)
+        {
+            float center_y = y + 0.5f;
+            // edge and depth values at x = 0 of this row, stepped per group of four
+            __m128 row0 = _mm_set1_ps(triangle.edge_b[0] * center_y + triangle.edge_c[0]);
+            __m128 row1 = _mm_set1_ps(triangle.edge_b[1] * center_y + triangle.edge_c[1]);
+            __m128 row2 = _mm_set1_ps(triangle.edge_b[2] * center_y + triangle.edge_c[2]);
+            __m128 row_depth = _mm_set1_ps(triangle.depth_b * center_y + triangle.depth_c);
+            float* row = depth + (size_t)y * size_x;
+            for(int x = x_begin; x <= x_end; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if(_mm_movemask_ps(inside) == 0)
+                    continue;
+                __m128 z = _mm_add_ps(_mm_mul_ps(depth_a, px), row_depth);
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::build_hiz()
+{
+    for(size_t level = 1; level < hiz.size(); level++)
+    {
+        const std::vector<float>& src = hiz[level - 1];
+        std::vector<float>& dst = hiz[level];
+        glm::ivec2 src_size = hiz_size[level - 1], dst_size = hiz_size[level];
+        for(int y = 0; y < dst_size.y; y++)
+        {
+            int y0 = std::min(2 * y, src_size.y - 1), y1 = std::min(2 * y + 1, src_size.y - 1);
+            for(int x = 0; x < dst_size.x; x++)
+            {
+                int x0 = std::min(2 * x, src_size.x - 1), x1 = std::min(2 * x + 1, src_size.x - 1);
+                // farthest occluder depth below this texel
+                dst[(size_t)y * dst_size.x + x] = std::max(std::max(src[(size_t)y0 * src_size.x + x0], src[(size_t)y0 * src_size.x + x1]),
+                                                           std::max(src[(size_t)y1 * src_size.x + x0], src[(size_t)y1 * src_size.x + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::is_visible(const glm::vec3& min, const glm::vec3& max) const
+{
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f, nearest = 1.0f;
+    // corners as the min corner plus the box edges, one matrix product instead of eight
+    glm::vec4 base = projection_view * glm::vec4(min, 1.0f);
+    glm::vec3 size = max - min;
+    glm::vec4 edge_x = projection_view[0] * size.x, edge_y = projection_view[1] * size.y, edge_z = projection_view[2] * size.z;
+    for(int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 clip = base;
+        if(corner & 1) clip += edge_x;
+        if(corner & 2) clip += edge_y;
+        if(corner & 4) clip += edge_z;
+        if(clip.z < -clip.w) // crosses the near plane
+            return true;
+        float inverse_w = 1.0f / clip.w;
+        float x = (clip.x * inverse_w * 0.5f + 0.5f) * size_x;
+        float y = (clip.y * inverse_w * 0.5f + 0.5f) * size_y;
+        min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+        nearest = std::min(nearest, clip.z * inverse_w * 0.5f + 0.5f);
+    }
+    if(max_x < 0.0f || max_y < 0.0f || min_x >= size_x || min_y >= size_y)
+        return true; // off screen, frustum culling's business
+
+    int x0 = std::max(0, (int)min_x), y0 = std::max(0, (int)min_y);
+    int x1 = std::min(size_x - 1, (int)max_x), y1 = std::min(size_y - 1, (int)max_y);
+    // first level where the rectangle covers at most 4 x 4 texels (16 reads), finer than 2 x 2 so small boxes
+    // near a depth edge aren't tested against the far side of it
+    size_t level = 0;
+    while(level + 1 < hiz.size() && (x1 - x0 >= 4 || y1 - y0 >= 4))
+    {
+        level++;
+        x0 >>= 1; y0 >>= 1; x1 >>= 1; y1 >>= 1;
+    }
+    const std::vector<float>& texels = hiz[level];
+    int stride = hiz_size[level].x;
+    for(int y = y0; y <= y1; y++)
+        for(int x = x0; x <= x1; x++)
+            if(nearest <= texels[(size_t)y * stride + x])
+                return true;
+    return false;
+}
+
+size_t OcclusionCuller::cull(const CullBounds& bounds, const uint32_t* candidates, size_t count, uint32_t* visible)
+{
+    size_t kept = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        uint32_t object = candidates[i];
+        glm::vec3 center(bounds.center_x[object], bounds.center_y[object], bounds.center_z[object]);
+        glm::vec3 extent(bounds.extent_x[object], bounds.extent_y[object], bounds.extent_z[object]);
+        if(is_visible(center - extent, center + extent))
+            visible[kept++] = object;
+    }
+    tested += count;
+    occluded += count - kept;
+    return kept;
+}
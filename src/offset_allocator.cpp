@@ -0,0 +1,218 @@
+#include "OffsetAllocator.hpp"
+#include <algorithm>
+
+OffsetAllocator::OffsetAllocator(uint32_t size)
+    : fl_bitmap(0), total(size), free_space(size), allocations(0), last(NO_SPACE)
+{
+    std::fill(sl_bitmap, sl_bitmap + FL_COUNT, 0u);
+    std::fill(&heads[0][0], &heads[0][0] + FL_COUNT * SL_COUNT, (uint32_t)NO_SPACE); // by value, NO_SPACE has no definition
+    if(size > 0)
+    {
+        last = new_node(0, size);
+        insert_free(last);
+    }
+}
+
+void OffsetAllocator::mapping(uint32_t size, int& fl, int& sl)
+{
+    if(size < (uint32_t)SL_COUNT) // small sizes get a class each
+    {
+        fl = 0;
+        sl = (int)size;
+        return;
+    }
+    int log2 = 31 - __builtin_clz(size);
+    fl = log2 - SL_BITS + 1;
+    sl = (int)((size >> (log2 - SL_BITS)) ^ SL_COUNT);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size)
+{
+    Allocation allocation;
+    if(size == 0 || size > free_space)
+        return allocation;
+
+    // round up to the next class boundary, so every block in the class found is large enough
+    uint32_t search = size;
+    if(size >= (uint32_t)SL_COUNT)
+    {
+        int log2 = 31 - __builtin_clz(size);
+        search = size + ((1u << (log2 - SL_BITS)) - 1);
+        if(search < size) // overflow
+            return allocation;
+    }
+    int fl, sl;
+    mapping(search, fl, sl);
+
+    uint32_t sl_map = sl_bitmap[fl] & (~0u << sl);
+    if(!sl_map)
+    {
+        uint32_t fl_map = (fl + 1 < FL_COUNT) ? fl_bitmap & (~0u << (fl + 1)) : 0;
+        if(!fl_map)
+            return allocation;
+        fl = __builtin_ctz(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    uint32_t node = heads[fl][sl];
+    remove_free(node);
+
+    // split off the tail as a new free block
+    if(nodes[node].size > size)
+    {
+        uint32_t rest = new_node(nodes[node].offset + size, nodes[node].size - size);
+        uint32_t next = nodes[node].next_neighbor;
+        nodes[rest].prev_neighbor = node;
+        nodes[rest].next_neighbor = next;
+        if(next != NO_SPACE)
+            nodes[next].prev_neighbor = rest;
+        nodes[node].next_neighbor = rest;
+        nodes[node].size = size;
+        if(last == node)
+            last = rest;
+        insert_free(rest);
+    }
+
+    nodes[node].used = true;
+    free_space -= size;
+    allocations++;
+    allocation.offset = nodes[node].offset;
+    allocation.node = node;
+    return allocation;
+}
+
+void OffsetAllocator::free(Allocation allocation)
+{
+    if(!allocation.valid() || allocation.node >= nodes.size() || !nodes[allocation.node].used)
+        return;
+    uint32_t node = allocation.node;
+    nodes[node].used = false;
+    free_space += nodes[node].size;
+    allocations--;
+
+    // merge with the free block before
+    uint32_t prev = nodes[node].prev_neighbor;
+    if(prev != NO_SPACE && !nodes[prev].used)
+    {
+        remove_free(prev);
+        nodes[prev].size += nodes[node].size;
+        nodes[prev].next_neighbor = nodes[node].next_neighbor;
+        if(nodes[node].next_neighbor != NO_SPACE)
+            nodes[nodes[node].next_neighbor].prev_neighbor = prev;
+        if(last == node)
+            last = prev;
+        spare_nodes.push_back(node);
+        node = prev;
+    }
+    // and the one after
+    uint32_t next = nodes[node].next_neighbor;
+    if(next != NO_SPACE && !nodes[next].used)
+    {
+        remove_free(next);
+        nodes[node].size += nodes[next].size;
+        nodes[node].next_neighbor = nodes[next].next_neighbor;
+        if(nodes[next].next_neighbor != NO_SPACE)
+            nodes[nodes[next].next_neighbor].prev_neighbor = node;
+        if(last == next)
+            last = node;
+        spare_nodes.push_back(next);
+    }
+    insert_free(node);
+}
+
+void OffsetAllocator::grow(uint32_t new_size)
+{
+    if(new_size <= total)
+        return;
+    uint32_t extra = new_size - total;
+    if(last != NO_SPACE && !nodes[last].used)
+    {
+        remove_free(last);
+        nodes[last].size += extra;
+        insert_free(last);
+    }
+    else
+    {
+        uint32_t node = new_node(total, extra);
+        nodes[node].prev_neighbor = last;
+        if(last != NO_SPACE)
+            nodes[last].next_neighbor = node;
+        last = node;
+        insert_free(node);
+    }
+    total = new_size;
+    free_space += extra;
+}
+
+OffsetAllocator::Stats OffsetAllocator::stats() const
+{
+    Stats stats;
+    stats.size = total;
+    stats.free = free_space;
+    stats.largest_free = 0;
+    stats.free_blocks = 0;
+    stats.allocations = allocations;
+    for(int fl = 0; fl < FL_COUNT; fl++)
+        for(int sl = 0; sl < SL_COUNT; sl++)
+            for(uint32_t node = heads[fl][sl]; node != NO_SPACE; node = nodes[node].next_free)
+            {
+                stats.free_blocks++;
+                stats.largest_free = std::max(stats.largest_free, nodes[node].size);
+            }
+    return stats;
+}
+
+uint32_t OffsetAllocator::new_node(uint32_t offset, uint32_t size)
+{
+    uint32_t index;
+    if(!spare_nodes.empty())
+    {
+        index = spare_nodes.back();
+        spare_nodes.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)nodes.size();
+        nodes.emplace_back();
+    }
+    Node& node = nodes[index];
+    node.offset = offset;
+    node.size = size;
+    node.prev_free = node.next_free = NO_SPACE;
+    node.prev_neighbor = node.next_neighbor = NO_SPACE;
+    node.used = false;
+    return index;
+}
+
+void OffsetAllocator::insert_free(uint32_t node)
+{
+    int fl, sl;
+    mapping(nodes[node].size, fl, sl);
+    uint32_t head = heads[fl][sl];
+    nodes[node].prev_free = NO_SPACE;
+    nodes[node].next_free = head;
+    if(head != NO_SPACE)
+        nodes[head].prev_free = node;
+    heads[fl][sl] = node;
+    fl_bitmap |= 1u << fl;
+    sl_bitmap[fl] |= 1u << sl;
+}
+
+void OffsetAllocator::remove_free(uint32_t node)
+{
+    int fl, sl;
+    mapping(nodes[node].size, fl, sl);
+    uint32_t prev = nodes[node].prev_free, next = nodes[node].next_free;
+    if(prev != NO_SPACE)
+        nodes[prev].next_free = next;
+    else
+        heads[fl][sl] = next;
+    if(next != NO_SPACE)
+        nodes[next].prev_free = prev;
+    if(heads[fl][sl] == NO_SPACE)
+    {
+        sl_bitmap[fl] &= ~(1u << sl);
+        if(!sl_bitmap[fl])
+            fl_bitmap &= ~(1u << fl);
+    }
+}
@@ -0,0 +1,179 @@
+#include "RenderQueue.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+
+DrawCommand mesh_draw_command(Shader& shader, const Mesh& mesh)
+{
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = mesh.VAO;
+    command.count = mesh.index_count;
+    command.index_type = mesh.index_type;
+    return command;
+}
+
+DrawCommand mesh_draw_command(Shader& shader, const MeshArena& arena, const MeshRange& mesh)
+{
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = arena.vao(mesh.format);
+    command.count = (GLsizei)(mesh.index_count ? mesh.index_count : mesh.vertex_count);
+    command.index_type = mesh.index_count ? MeshArena::index_type : 0;
+    command.first_index = mesh.first_index;
+    command.base_vertex = mesh.base_vertex;
+    return command;
+}
+
+DrawCommand batch_draw_command(Shader& shader, const MeshArena& arena, IndirectBatch& batch)
+{
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = arena.vao(FORMAT_LIT);
+    command.batch = &batch;
+    return command;
+}
+
+uint64_t make_sort_key(RenderPass pass, GLuint program, uint16_t material, GLuint vao, float depth01)
+{
+    uint64_t depth = (uint64_t)(glm::clamp(depth01, 0.0f, 1.0f) * 0xFFFFF);
+    return ((uint64_t)(pass & 0xF) << 60)
+         | ((uint64_t)(program & 0xFFF) << 48)
+         | ((uint64_t)material << 32)
+         | ((uint64_t)(vao & 0xFFF) << 20)
+         | depth;
+}
+
+RenderQueue::RenderQueue()
+    : program_changes(0), draws(0), sorted(false), next(0) {}
+
+void RenderQueue::clear()
+{
+    program_changes = 0;
+    draws = 0;
+    drop_commands();
+}
+
+void RenderQueue::drop_commands()
+{
+    commands.clear();
+    keys.clear();
+    sorted = false;
+    next = 0;
+}
+
+void RenderQueue::submit(RenderPass pass, const DrawCommand& command, float depth01)
+{
+    keys.push_back(make_sort_key(pass, command.shader->ID, command.material, command.vao, depth01));
+    commands.push_back(command);
+}
+
+void RenderQueue::sort()
+{
+    const size_t n = keys.size();
+    order.resize(n);
+    scratch.resize(n);
+    for(size_t i = 0; i < n; i++)
+        order[i] = (uint32_t)i;
+
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        size_t histogram[256] = {};
+        for(size_t i = 0; i < n; i++)
+            histogram[(keys[i] >> shift) & 0xFF]++;
+        if(histogram[(keys[0] >> shift) & 0xFF] == n) // all keys share this byte
+            continue;
+
+        size_t offset = 0;
+        for(size_t& bucket : histogram)
+        {
+            size_t count = bucket;
+            bucket = offset;
+            offset += count;
+        }
+        for(size_t i = 0; i < n; i++)
+        {
+            uint32_t index = order[i];
+            scratch[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+        }
+        order.swap(scratch);
+    }
+}
+
+void RenderQueue::flush()
+{
+    flush_through((RenderPass)0xF);
+}
+
+void RenderQueue::flush_through(RenderPass last)
+{
+    if(!sorted)
+    {
+        if(commands.empty())
+            return;
+        sort();
+        sorted = true;
+    }
+
+    // handles of the current program, resolved once per program change
+    const Shader* current = nullptr;
+    UniformHandle modelLoc, normalMatLoc, layerLoc, instancedLoc;
+    int instanced = -1; // unknown
+
+    for(; next < order.size(); next++)
+    {
+        uint32_t index = order[next];
+        if((RenderPass)(keys[index] >> 60) > last)
+            return; // the rest waits for a later flush
+        const DrawCommand& command = commands[index];
+        if(command.shader != current)
+        {
+            current = command.shader;
+            command.shader->use();
+            modelLoc = current->uniform(uniform_hash("model"));
+            normalMatLoc = current->uniform(uniform_hash("normalMat"));
+            layerLoc = current->uniform(uniform_hash("layer"));
+            instancedLoc = current->uniform(uniform_hash("instanced"));
+            instanced = -1;
+            program_changes++;
+        }
+        for(GLuint unit = 0; unit < 2; unit++)
+            if(command.textures[unit])
+                gl_state().bind_texture_unit(unit, command.texture_target, command.textures[unit]);
+        gl_state().bind_vertex_array(command.vao);
+
+        int wantInstanced = command.instance_count > 0 || command.batch;
+        if(wantInstanced != instanced)
+        {
+            current->set(instancedLoc, (bool)wantInstanced);
+            instanced = wantInstanced;
+        }
+
+        if(command.batch)
+        {
+            command.batch->draw(command.mode);
+            draws += command.batch->draw_calls;
+            continue;
+        }
+
+        const void* indices = (void*)(command.first_index * (command.index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)));
+        if(wantInstanced)
+        {
+            if(command.index_type)
+                glDrawElementsInstancedBaseVertex(command.mode, command.count, command.index_type, indices, command.instance_count, command.base_vertex);
+            else
+                glDrawArraysInstanced(command.mode, command.base_vertex, command.count, command.instance_count);
+        }
+        else
+        {
+            current->set(modelLoc, command.model);
+            current->set(normalMatLoc, command.normalMat);
+            current->set(layerLoc, command.layer);
+            if(command.index_type)
+                glDrawElementsBaseVertex(command.mode, command.count, command.index_type, indices, command.base_vertex);
+            else
+                glDrawArrays(command.mode, command.base_vertex, command.count);
+        }
+        draws++;
+    }
+    drop_commands(); // the counters keep adding up until clear()
+}
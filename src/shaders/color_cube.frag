@@ -1,76 +1,211 @@
 #version 330 core
 
+// three variants of one file:
+//   default            forward Phong, material textures in, lit color out
+//   GBUFFER_PASS       deferred geometry pass, material textures in, G-buffer out (GBuffer.hpp)
+//   DEFERRED_LIGHTING  deferred lighting pass over a full-screen triangle, G-buffer in, lit color out
+#ifdef GBUFFER_PASS
+layout(location = 0) out vec4 gAlbedoOut;   // rgb albedo
+layout(location = 1) out vec4 gSpecularOut; // rgb specular, a = shininess / 256
+layout(location = 2) out vec4 gNormalOut;   // xyz world normal
+#else
 out vec4 fragColor;
+#endif
 
+#ifdef DEFERRED_LIGHTING
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+// rebuilt from the G-buffer in main()
+vec3 normal;
+vec3 fragPos;
+#else
 in vec3 normal;
 in vec3 fragPos;
 in vec2 texCoords;
+flat in int materialLayer;
+#endif
 
+// MATERIAL_ARRAY: every material is a layer of the two arrays (MaterialLibrary), picked per instance
 struct Material {
+#ifdef MATERIAL_ARRAY
+    sampler2DArray diffuseMap;
+    sampler2DArray specularMap;
+#else
     sampler2D diffuseMap;
     sampler2D specularMap;
+#endif
     sampler2D emissionMap;
     float shininess;
 };
 
+// mirrors GpuLight (Lights.hpp), filled by LightUniforms after frustum culling,
+// or with CLUSTERED_LIGHTS by LightClusters into buffer textures, binned per view space cluster
+#define LIGHT_DIRECTIONAL 0
+#define LIGHT_POINT 1
+#define LIGHT_SPOT 2
 struct Light {
-    vec3 position; // not necessary when using directional.
-    vec3 direction;   
-    float cutOff;
+    vec4 position;    // xyz, w = type
+    vec4 direction;   // xyz, w = range
+    vec4 ambient;
+    vec4 diffuse;     // w = cos inner cutoff
+    vec4 specular;    // w = cos outer cutoff
+    vec4 attenuation; // constant, linear, quadratic
+};
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+#ifdef CLUSTERED_LIGHTS
+layout(std140) uniform Clusters
+{
+    uvec4 clusterGrid;  // xyz cells, w = global lights (shaded everywhere) at the front of clusterLights
+    vec4 clusterDepth;  // slice = log(depth) * x + y, zw = 1 / viewport size
+};
+uniform samplerBuffer clusterLights;    // 6 texels per light
+uniform usamplerBuffer clusterRanges;   // per cluster: first index, count
+uniform usamplerBuffer clusterIndices;
+#else
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 16
+#endif
+layout(std140) uniform Lights
+{
+    ivec4 lightCount; // x
+    Light lights[MAX_LIGHTS];
+};
+#endif
 
-    float constant;
-    float linear;
-    float quadratic;
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
 };
 
 uniform Material material;
-uniform Light light;
-uniform vec3 viewPos;
 
-void main()
+#if defined(DEFERRED_LIGHTING)
+vec3 diffuseColor() { return texelFetch(gAlbedo, ivec2(gl_FragCoord.xy), 0).rgb; }
+vec3 specularColor() { return texelFetch(gSpecular, ivec2(gl_FragCoord.xy), 0).rgb; }
+#elif defined(MATERIAL_ARRAY)
+vec3 diffuseColor() { return texture(material.diffuseMap, vec3(texCoords, materialLayer)).rgb; }
+vec3 specularColor() { return texture(material.specularMap, vec3(texCoords, materialLayer)).rgb; }
+#else
+vec3 diffuseColor() { return texture(material.diffuseMap, texCoords).rgb; }
+vec3 specularColor() { return texture(material.specularMap, texCoords).rgb; }
+#endif
+
+vec3 shade(Light light, vec3 norm, vec3 viewDir, vec3 albedo, vec3 specColor, float shininess)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-    float theta = dot(lightDir, normalize(-light.direction));
+    int type = int(light.position.w);
+    // ambient: unattenuated and not limited by range, it keeps the scene from going black outside the flashlight
+    vec3 ambient = light.ambient.rgb * albedo;
+
+    vec3 lightDir;
+    float attenuation = 1.0f;
+    if(type == LIGHT_DIRECTIONAL)
+        lightDir = normalize(-light.direction.xyz);
+    else
+    {
+        vec3 toLight = light.position.xyz - fragPos;
+        float distance = length(toLight); // think magnitude
+        if(distance > light.direction.w)
+            return ambient;
+        lightDir = toLight / distance;
+        attenuation = 1.0f / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * distance * distance);
+    }
+
+    // diffuse
+    float diff = max(dot(norm, lightDir), 0.0f);    // use max to ensure never a negative diffuse component
+    vec3 diffuse = light.diffuse.rgb * diff * albedo;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, norm);   // reflect light dir
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0) , shininess);
+    vec3 specular = light.specular.rgb * spec * specColor;
 
-    if(theta > light.cutOff) // for flashlight calculations
+    // spot-light: full intensity inside the inner cone, smooth falloff to the outer one, ambient only outside
+    if(type == LIGHT_SPOT)
     {
-        // ambient
-        vec3 ambient = light.ambient * texture(material.diffuseMap, texCoords).rgb;
-
-        // diffuse
-        vec3 norm = normalize(normal);
-        //vec3 lightDir = normalize(-light.direction);
-        float diff = max(dot(norm, lightDir), 0.0f);    // use max to ensure never a negative diffuse component
-        vec3 diffuse = light.diffuse * diff * texture(material.diffuseMap, texCoords).rgb;
-
-        // specular
-        vec3 viewDir = normalize(viewPos - fragPos);
-        vec3 reflectDir = reflect(-lightDir, norm);   // reflect light dir
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0) , material.shininess);
-        vec3 specular = light.specular * spec * texture(material.specularMap, texCoords).rgb;
-
-        // emmission
-        //vec3 emission = texture(material.emissionMap, texCoords).rgb;
-
-        // attenuation calculation (for spot-light)
-        float distance = length(light.position - fragPos); // think magnitude
-        float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * pow(distance, 2));
-
-        ambient *= attenuation;
-        diffuse *= attenuation;
-        specular *= attenuation;
-        // //emmission *= attenuation;
-
-        // Phong
-        vec3 result = ambient + diffuse + specular;
-        fragColor = vec4(result, 1.0f);
+        float theta = dot(lightDir, normalize(-light.direction.xyz));
+        float intensity = clamp((theta - light.specular.w) / max(light.diffuse.w - light.specular.w, 1e-4), 0.0, 1.0);
+        diffuse *= intensity;
+        specular *= intensity;
     }
-    else // use ambient light so scene is not completely dark outside the spotlight
+
+    // Phong
+    return ambient + (diffuse + specular) * attenuation;
+}
+
+#ifdef CLUSTERED_LIGHTS
+Light fetchLight(int index)
+{
+    int texel = index * 6;
+    Light light;
+    light.position = texelFetch(clusterLights, texel);
+    light.direction = texelFetch(clusterLights, texel + 1);
+    light.ambient = texelFetch(clusterLights, texel + 2);
+    light.diffuse = texelFetch(clusterLights, texel + 3);
+    light.specular = texelFetch(clusterLights, texel + 4);
+    light.attenuation = texelFetch(clusterLights, texel + 5);
+    return light;
+}
+
+// same slicing as ClusterGrid: screen tile, then exponential depth slice
+int clusterIndex()
+{
+    float depth = -(view * vec4(fragPos, 1.0f)).z;
+    ivec3 grid = ivec3(clusterGrid.xyz);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterDepth.zw * vec2(grid.xy)), grid.xy - 1);
+    int slice = clamp(int(floor(log(depth) * clusterDepth.x + clusterDepth.y)), 0, grid.z - 1);
+    return tile.x + grid.x * (tile.y + grid.y * slice);
+}
+#endif
+
+#ifdef GBUFFER_PASS
+void main()
+{
+    gAlbedoOut = vec4(diffuseColor(), 1.0f);
+    gSpecularOut = vec4(specularColor(), material.shininess / 256.0f);
+    gNormalOut = vec4(normalize(normal), 0.0f);
+}
+#else
+void main()
+{
+#ifdef DEFERRED_LIGHTING
+    float depth = texelFetch(gDepth, ivec2(gl_FragCoord.xy), 0).r;
+    if(depth == 1.0f) // nothing was drawn here
     {
-        fragColor = vec4(light.ambient * vec3(texture(material.diffuseMap, texCoords)), 1.0f);
-    }  
-}
\ No newline at end of file
+        fragColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return;
+    }
+    // depth -> view space through the perspective matrix, then back to world space through the (rigid) view matrix
+    vec3 ndc = vec3(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)), depth) * 2.0f - 1.0f;
+    float viewZ = -projection[3][2] / (ndc.z + projection[2][2]);
+    vec3 viewSpace = vec3(-ndc.x * viewZ / projection[0][0], -ndc.y * viewZ / projection[1][1], viewZ);
+    fragPos = transpose(mat3(view)) * (viewSpace - view[3].xyz);
+    normal = texelFetch(gNormal, ivec2(gl_FragCoord.xy), 0).xyz;
+    float shininess = texelFetch(gSpecular, ivec2(gl_FragCoord.xy), 0).a * 256.0f;
+#else
+    float shininess = material.shininess;
+#endif
+    vec3 norm = normalize(normal);
+    vec3 viewDir = normalize(viewPos.xyz - fragPos);
+    vec3 albedo = diffuseColor();
+    vec3 specColor = specularColor();
+
+    vec3 result = vec3(0.0f);
+#ifdef CLUSTERED_LIGHTS
+    for(int i = 0; i < int(clusterGrid.w); i++)
+        result += shade(fetchLight(i), norm, viewDir, albedo, specColor, shininess);
+    uvec2 range = texelFetch(clusterRanges, clusterIndex()).xy;
+    for(uint i = 0u; i < range.y; i++)
+        result += shade(fetchLight(int(texelFetch(clusterIndices, int(range.x + i)).r)), norm, viewDir, albedo, specColor, shininess);
+#else
+    int count = min(lightCount.x, MAX_LIGHTS);
+    for(int i = 0; i < count; i++)
+        result += shade(lights[i], norm, viewDir, albedo, specColor, shininess);
+#endif
+
+    fragColor = vec4(result, 1.0f);
+}
+#endif
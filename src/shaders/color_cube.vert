@@ -3,21 +3,36 @@
 layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNormal;
 layout(location=2) in vec2 aTexCoords;
+layout(location=3) in mat4 aModel;      // per-instance
+layout(location=7) in mat4 aNormalMat;  // per-instance
+layout(location=11) in uint aLayer;     // per-instance material layer
 
 out vec3 fragPos;
 out vec3 normal;
 out vec2 texCoords;
+flat out int materialLayer;
+
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 normalMat;
+uniform int layer;
+uniform bool instanced; // take model/normalMat/layer from the instance buffer instead of the uniforms
 
 void main()
 {
-    fragPos = vec3(model * vec4(aPos, 1.0f));
-    normal = mat3(normalMat) * aNormal;
+    mat4 M = instanced ? aModel : model;
+    mat4 N = instanced ? aNormalMat : normalMat;
+
+    fragPos = vec3(M * vec4(aPos, 1.0f));
+    normal = mat3(N) * aNormal;
     texCoords = aTexCoords;
+    materialLayer = instanced ? int(aLayer) : layer;
     
     gl_Position = projection * view * vec4(fragPos, 1.0);
-}
\ No newline at end of file
+}
@@ -2,7 +2,14 @@
 
 layout(location=0) in vec3 aPos;
 
-uniform mat4 model, view, projection;
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
+
+uniform mat4 model;
 
 void main()
 {
@@ -2,9 +2,14 @@
 
 layout(location=0) in vec3 aPos;
 
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
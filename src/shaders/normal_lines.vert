@@ -1,12 +1,20 @@
 #version 330 core
 
 layout(location=0) in vec3 aPos;
+layout(location=3) in mat4 aModel; // per-instance
+
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
-}
\ No newline at end of file
+    mat4 M = instanced ? aModel : model;
+    gl_Position = projection * view * M * vec4(aPos, 1.0f);
+}
@@ -7,7 +7,14 @@ layout(location=2) in vec2 aTexCoord;
 out vec3 someColor;
 out vec2 texCoord;
 
-uniform mat4 model, view, projection;
+layout(std140) uniform Camera
+{
+	mat4 projection;
+	mat4 view;
+	vec4 viewPos;
+};
+
+uniform mat4 model;
 
 void main()
 {
@@ -0,0 +1,10 @@
+#version 330 core
+
+in vec3 someColor;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(someColor, 1.0f);
+}
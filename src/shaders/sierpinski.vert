@@ -0,0 +1,20 @@
+#version 330 core
+
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aColor;
+layout(location=3) in mat4 aModel; // per-instance leaf transform
+
+out vec3 someColor;
+
+layout(std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
+
+void main()
+{
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0f);
+    someColor = aColor;
+}
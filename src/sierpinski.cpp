@@ -0,0 +1,75 @@
+#include "sierpinski.hpp"
+#include "Parallel.hpp"
+
+namespace
+{
+    // child offsets of one subdivision step: bottom left, bottom right, top
+    const glm::vec3 OFFSETS[3] = { glm::vec3(-1, -1, 0), glm::vec3(1, -1, 0), glm::vec3(0, 1, 0) };
+
+    // the lowest LOW_DIGITS levels are tabulated, the remaining digits are constant across a block of 3^LOW_DIGITS leaves
+    const int LOW_DIGITS = 7;
+
+    // translation contributed by `digits` base-3 digits of index, the least significant one sitting at level `deepest_level`
+    glm::vec3 digit_translation(size_t index, int digits, int deepest_level)
+    {
+        glm::vec3 translation(0.0f);
+        float scale = glm::pow(0.5f, float(deepest_level + 1));
+        for(int d = 0; d < digits; d++)
+        {
+            translation += scale * OFFSETS[index % 3];
+            index /= 3;
+            scale *= 2.0f;
+        }
+        return translation;
+    }
+}
+
+size_t sierpinski_leaf_count(int degree)
+{
+    size_t count = 1;
+    for(int i = 0; i < degree; i++)
+        count *= 3;
+    return count;
+}
+
+void generate_sierpinski(glm::mat4* out, int degree, const glm::mat4& root)
+{
+    const int low_digits = degree < LOW_DIGITS ? degree : LOW_DIGITS;
+    const int high_digits = degree - low_digits;
+    const size_t block_size = sierpinski_leaf_count(low_digits);
+    const size_t n_blocks = sierpinski_leaf_count(high_digits);
+
+    // translations of the deepest levels, shared by every block
+    std::vector<glm::vec3> low_table(block_size);
+    for(size_t i = 0; i < block_size; i++)
+        low_table[i] = digit_translation(i, low_digits, degree - 1);
+
+    // every leaf has the same linear part, only the translation column differs
+    const float leaf_scale = glm::pow(0.5f, float(degree));
+    const glm::vec4 col0 = root[0] * leaf_scale;
+    const glm::vec4 col1 = root[1] * leaf_scale;
+    const glm::vec4 col2 = root[2] * leaf_scale;
+
+    parallel_for(0, n_blocks, [&](size_t block_begin, size_t block_end)
+    {
+        for(size_t block = block_begin; block < block_end; block++)
+        {
+            glm::vec3 high = digit_translation(block, high_digits, high_digits - 1);
+            glm::mat4* leaf = out + block * block_size;
+            for(size_t i = 0; i < block_size; i++) // branch free, vectorizes across leaves
+            {
+                glm::vec3 t = high + low_table[i];
+                leaf[i][0] = col0;
+                leaf[i][1] = col1;
+                leaf[i][2] = col2;
+                leaf[i][3] = root[0] * t.x + root[1] * t.y + root[2] * t.z + root[3];
+            }
+        }
+    });
+}
+
+void setup_sierpinski(std::vector<glm::mat4>& transformations, int degree, const glm::mat4& root)
+{
+    transformations.resize(sierpinski_leaf_count(degree));
+    generate_sierpinski(transformations.data(), degree, root);
+}
@@ -0,0 +1,68 @@
+#include "SierpinskiMesh.hpp"
+#include "GLState.hpp"
+
+SierpinskiMesh::SierpinskiMesh(MeshArena& arena)
+    : arena(arena), degree(-1), generated(false) {}
+
+void SierpinskiMesh::update(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int degree)
+{
+    if(generated && this->degree == degree && corners[0] == v1 && corners[1] == v2 && corners[2] == v3)
+        return;
+
+    corners[0] = v1;
+    corners[1] = v2;
+    corners[2] = v3;
+    this->degree = degree;
+    generate();
+
+    // a new range per change, the old one goes back to the arena and merges with its free neighbours
+    arena.free(mesh);
+    mesh = arena.add(FORMAT_COLORED, vertices.data(), vertex_count());
+    generated = true;
+}
+
+void SierpinskiMesh::draw() const
+{
+    gl_state().bind_vertex_array(arena.vao(FORMAT_COLORED));
+    glDrawArrays(GL_TRIANGLES, mesh.base_vertex, (GLsizei)mesh.vertex_count);
+}
+
+void SierpinskiMesh::destroy()
+{
+    arena.free(mesh);
+    generated = false;
+}
+
+void SierpinskiMesh::generate()
+{
+    // a degree n triangle has exactly 3^n leaf triangles, so reserve once and never reallocate
+    size_t n_triangles = 1;
+    for(int i = 0; i < degree; i++)
+        n_triangles *= 3;
+    vertices.clear();
+    vertices.reserve(n_triangles * 3 * FLOATS_PER_VERTEX);
+
+    subdivide(corners[0], corners[1], corners[2], degree);
+}
+
+void SierpinskiMesh::subdivide(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int depth)
+{
+    if(depth <= 0)
+    {
+        vertices.insert(vertices.end(), 
+        {
+            v1.x, v1.y, v1.z,   1, 0, 0,    // RED
+            v2.x, v2.y, v2.z,   0, 1, 0,    // GREEN
+            v3.x, v3.y, v3.z,   0, 0, 1     // BLUE
+        });
+        return;
+    }
+
+    glm::vec3 mid1 = 0.5f * (v1 + v2);
+    glm::vec3 mid2 = 0.5f * (v2 + v3);
+    glm::vec3 mid3 = 0.5f * (v1 + v3);
+
+    subdivide(v1, mid1, mid3, depth - 1);
+    subdivide(mid1, v2, mid2, depth - 1);
+    subdivide(mid3, mid2, v3, depth - 1);
+}
@@ -0,0 +1,102 @@
+#include "Sphere.hpp"
+#include <cmath>
+#include <algorithm>
+#include <tuple>
+
+const MeshData& Sphere::get(int nStacks, int nSectors)
+{
+    static std::map<std::pair<int, int>, MeshData> cache;
+
+    nStacks = std::max(nStacks, MIN_STACKS);
+    nSectors = std::max(nSectors, MIN_SECTORS);
+    auto key = std::make_pair(nStacks, nSectors);
+    auto it = cache.find(key);
+    if(it == cache.end())
+        it = cache.emplace(key, generate(nStacks, nSectors)).first;
+    return it->second;
+}
+
+std::vector<const MeshData*> Sphere::get_lod_chain(int nStacks, int nSectors, int nLevels)
+{
+    std::vector<const MeshData*> chain;
+    chain.reserve(nLevels);
+    for(int level = 0; level < nLevels; level++)
+    {
+        chain.push_back(&get(nStacks, nSectors));
+        nStacks = std::max(nStacks / 2, MIN_STACKS);
+        nSectors = std::max(nSectors / 2, MIN_SECTORS);
+    }
+    return chain;
+}
+
+const Sphere::TrigTable& Sphere::get_trig_table(int nSteps, double startAngle, double angleStep)
+{
+    static std::map<std::tuple<int, double, double>, TrigTable> cache;
+
+    auto key = std::make_tuple(nSteps, startAngle, angleStep);
+    auto it = cache.find(key);
+    if(it != cache.end())
+        return it->second;
+
+    TrigTable table;
+    table.sines.resize(nSteps + 1);
+    table.cosines.resize(nSteps + 1);
+    for(int i = 0; i <= nSteps; i++)
+    {
+        double angle = startAngle + i * angleStep;
+        table.sines[i] = (float)std::sin(angle);
+        table.cosines[i] = (float)std::cos(angle);
+    }
+    return cache.emplace(key, std::move(table)).first->second;
+}
+
+MeshData Sphere::generate(int nStacks, int nSectors)
+{
+    // stack angle goes from pi/2 (north pole) to -pi/2, sector angle from 0 to 2pi
+    const TrigTable& stacks = get_trig_table(nStacks, M_PI / 2.0, -M_PI / nStacks);
+    const TrigTable& sectors = get_trig_table(nSectors, 0.0, 2.0 * M_PI / nSectors);
+
+    MeshData sphere;
+    sphere.vertices.resize((nStacks + 1) * (nSectors + 1));
+    sphere.indices.resize(6 * nSectors * (nStacks - 1));
+
+    // vertices: one ring per stack, the first/last sector duplicated so the texture seam gets its own uv
+    Vertex* vertex = sphere.vertices.data();
+    for(int i = 0; i <= nStacks; i++)
+    {
+        float xz = stacks.cosines[i]; // ring radius
+        float y = stacks.sines[i];
+        for(int j = 0; j <= nSectors; j++, vertex++)
+        {
+            glm::vec3 position(xz * sectors.cosines[j], y, -xz * sectors.sines[j]);
+            vertex->position = position;
+            vertex->normal = position; // unit sphere, the normal is the position
+            vertex->tex_coords = glm::vec2((float)j / nSectors, 1.0f - (float)i / nStacks);
+        }
+    }
+
+    // indices: each band between two rings is walked like a triangle strip (k1 top ring, k2 bottom ring),
+    // the pole bands only need one triangle per sector
+    uint32_t* index = sphere.indices.data();
+    for(int i = 0; i < nStacks; i++)
+    {
+        uint32_t k1 = i * (nSectors + 1);
+        uint32_t k2 = k1 + nSectors + 1;
+        for(int j = 0; j < nSectors; j++, k1++, k2++)
+        {
+            if(i != 0)
+            {
+                *index++ = k1;  *index++ = k2;  *index++ = k1 + 1;
+            }
+            if(i != nStacks - 1)
+            {
+                *index++ = k1 + 1;  *index++ = k2;  *index++ = k2 + 1;
+            }
+        }
+    }
+
+    MeshBuilder builder;
+    builder.reserve(sphere.vertices.size(), sphere.indices.size());
+    builder.add_indexed(sphere);
+    return builder.build();
+}
@@ -0,0 +1,376 @@
+#include "TextureCompression.hpp"
+#include "Parallel.hpp"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // one 4x4 block as float planes, r g b a
+    struct Block
+    {
+        alignas(16) float c[4][16];
+    };
+
+    void load_block(const unsigned char* pixels, int width, int height, int channels, int bx, int by, Block& block)
+    {
+        for(int y = 0; y < 4; y++)
+        {
+            int sy = std::min(by * 4 + y, height - 1);
+            for(int x = 0; x < 4; x++)
+            {
+                int sx = std::min(bx * 4 + x, width - 1);
+                const unsigned char* p = pixels + ((size_t)sy * width + sx) * channels;
+                int i = y * 4 + x;
+                switch(channels)
+                {
+                case 1: block.c[0][i] = block.c[1][i] = block.c[2][i] = p[0]; block.c[3][i] = 255.0f; break;
+                case 2: block.c[0][i] = p[0]; block.c[1][i] = p[1]; block.c[2][i] = 0.0f; block.c[3][i] = 255.0f; break;
+                case 3: block.c[0][i] = p[0]; block.c[1][i] = p[1]; block.c[2][i] = p[2]; block.c[3][i] = 255.0f; break;
+                default: block.c[0][i] = p[0]; block.c[1][i] = p[1]; block.c[2][i] = p[2]; block.c[3][i] = p[3]; break;
+                }
+            }
+        }
+    }
+
+    inline float horizontal_min(__m128 v)
+    {
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float horizontal_max(__m128 v)
+    {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float horizontal_sum(__m128 v)
+    {
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    void plane_min_max(const float* plane, float& lo, float& hi)
+    {
+        __m128 p0 = _mm_load_ps(plane), p1 = _mm_load_ps(plane + 4), p2 = _mm_load_ps(plane + 8), p3 = _mm_load_ps(plane + 12);
+        lo = horizontal_min(_mm_min_ps(_mm_min_ps(p0, p1), _mm_min_ps(p2, p3)));
+        hi = horizontal_max(_mm_max_ps(_mm_max_ps(p0, p1), _mm_max_ps(p2, p3)));
+    }
+
+    // projects 16 values onto [0, steps] and rounds: t = clamp((v - origin) . axis * scale, 0, steps)
+    void project_indices(const Block& block, int n_channels, const float* origin, const float* axis, float scale, float steps, int* t)
+    {
+        for(int i = 0; i < 16; i += 4)
+        {
+            __m128 dot = _mm_setzero_ps();
+            for(int c = 0; c < n_channels; c++)
+            {
+                __m128 diff = _mm_sub_ps(_mm_load_ps(block.c[c] + i), _mm_set1_ps(origin[c]));
+                dot = _mm_add_ps(dot, _mm_mul_ps(diff, _mm_set1_ps(axis[c])));
+            }
+            dot = _mm_mul_ps(dot, _mm_set1_ps(scale));
+            dot = _mm_min_ps(_mm_max_ps(dot, _mm_setzero_ps()), _mm_set1_ps(steps));
+            _mm_storeu_si128((__m128i*)(t + i), _mm_cvtps_epi32(dot)); // rounds to nearest
+        }
+    }
+
+    inline int to_565(const float* rgb)
+    {
+        int r = (int)(std::min(std::max(rgb[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        int g = (int)(std::min(std::max(rgb[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+        int b = (int)(std::min(std::max(rgb[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    inline void from_565(int c, int* rgb)
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    inline void write_u16(unsigned char* out, int v)
+    {
+        out[0] = (unsigned char)(v & 0xFF);
+        out[1] = (unsigned char)(v >> 8);
+    }
+
+    // BC1 color block, always in four color mode (color0 > color1) so it is also valid inside BC3
+    void encode_color_block(const Block& block, unsigned char* out)
+    {
+        float lo[3], hi[3];
+        for(int c = 0; c < 3; c++)
+            plane_min_max(block.c[c], lo[c], hi[c]);
+
+        // the box diagonal from lo to hi assumes every channel rises together, flip r / b where they fall against g
+        __m128 cov_rg = _mm_setzero_ps(), cov_bg = _mm_setzero_ps();
+        __m128 mid_r = _mm_set1_ps((lo[0] + hi[0]) * 0.5f), mid_g = _mm_set1_ps((lo[1] + hi[1]) * 0.5f), mid_b = _mm_set1_ps((lo[2] + hi[2]) * 0.5f);
+        for(int i = 0; i < 16; i += 4)
+        {
+            __m128 g = _mm_sub_ps(_mm_load_ps(block.c[1] + i), mid_g);
+            cov_rg = _mm_add_ps(cov_rg, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.c[0] + i), mid_r), g));
+            cov_bg = _mm_add_ps(cov_bg, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.c[2] + i), mid_b), g));
+        }
+        if(horizontal_sum(cov_rg) < 0.0f)
+            std::swap(lo[0], hi[0]);
+        if(horizontal_sum(cov_bg) < 0.0f)
+            std::swap(lo[2], hi[2]);
+
+        // pull the endpoints in by 1/16 of the range, the box corners are usually outliers
+        for(int c = 0; c < 3; c++)
+        {
+            float inset = (hi[c] - lo[c]) / 16.0f;
+            hi[c] -= inset;
+            lo[c] += inset;
+        }
+
+        int c0 = to_565(hi), c1 = to_565(lo);
+        if(c0 < c1)
+            std::swap(c0, c1);
+        write_u16(out, c0);
+        write_u16(out + 2, c1);
+        if(c0 == c1) // flat block, every index 0
+        {
+            std::memset(out + 4, 0, 4);
+            return;
+        }
+
+        int e0[3], e1[3];
+        from_565(c0, e0);
+        from_565(c1, e1);
+        float origin[3] = { (float)e1[0], (float)e1[1], (float)e1[2] };
+        float axis[3] = { (float)(e0[0] - e1[0]), (float)(e0[1] - e1[1]), (float)(e0[2] - e1[2]) };
+        float length_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+        alignas(16) int t[16];
+        project_indices(block, 3, origin, axis, 3.0f / length_sq, 3.0f, t);
+        static const uint32_t INDEX[4] = { 1, 3, 2, 0 }; // t = 0 is color1, t = 3 is color0, 1/3 and 2/3 in between
+        uint32_t indices = 0;
+        for(int i = 0; i < 16; i++)
+            indices |= INDEX[t[i]] << (2 * i);
+        std::memcpy(out + 4, &indices, 4); // little endian
+    }
+
+    // BC4 block / BC3 alpha block in eight value mode (endpoint0 > endpoint1)
+    void encode_channel_block(const Block& block, int channel, unsigned char* out)
+    {
+        float lo, hi;
+        plane_min_max(block.c[channel], lo, hi);
+        int a0 = (int)(hi + 0.5f), a1 = (int)(lo + 0.5f);
+        out[0] = (unsigned char)a0;
+        out[1] = (unsigned char)a1;
+        if(a0 == a1)
+        {
+            std::memset(out + 2, 0, 6);
+            return;
+        }
+
+        float origin[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        origin[channel] = (float)a1;
+        axis[channel] = 1.0f;
+        alignas(16) int t[16];
+        project_indices(block, channel + 1, origin, axis, 7.0f / (a0 - a1), 7.0f, t);
+        static const uint64_t INDEX[8] = { 1, 7, 6, 5, 4, 3, 2, 0 }; // t = 0 is endpoint1, t = 7 is endpoint0
+        uint64_t indices = 0;
+        for(int i = 0; i < 16; i++)
+            indices |= INDEX[t[i]] << (3 * i);
+        for(int i = 0; i < 6; i++)
+            out[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+
+    void decode_color_block(const unsigned char* in, unsigned char* rgba, int stride, int w, int h)
+    {
+        int c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+        int palette[4][4];
+        from_565(c0, palette[0]);
+        from_565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        for(int c = 0; c < 3; c++)
+        {
+            if(c0 > c1)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[3][3] = c0 > c1 ? 255 : 0;
+        uint32_t indices;
+        std::memcpy(&indices, in + 4, 4);
+        for(int y = 0; y < h; y++)
+        {
+            for(int x = 0; x < w; x++)
+            {
+                const int* p = palette[(indices >> (2 * (y * 4 + x))) & 3];
+                unsigned char* dst = rgba + (size_t)y * stride + x * 4;
+                dst[0] = (unsigned char)p[0];
+                dst[1] = (unsigned char)p[1];
+                dst[2] = (unsigned char)p[2];
+                dst[3] = (unsigned char)p[3];
+            }
+        }
+    }
+
+    void clear_block(unsigned char* rgba, int stride, int w, int h)
+    {
+        for(int y = 0; y < h; y++)
+        {
+            for(int x = 0; x < w; x++)
+            {
+                unsigned char* dst = rgba + (size_t)y * stride + x * 4;
+                dst[0] = dst[1] = dst[2] = 0;
+                dst[3] = 255;
+            }
+        }
+    }
+
+    void decode_channel_block(const unsigned char* in, unsigned char* rgba, int stride, int w, int h, int channel)
+    {
+        int a0 = in[0], a1 = in[1];
+        int palette[8] = { a0, a1 };
+        for(int i = 2; i < 8; i++)
+        {
+            if(a0 > a1)
+                palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+            else
+                palette[i] = i < 6 ? ((6 - i) * a0 + (i - 1) * a1) / 5 : (i == 6 ? 0 : 255);
+        }
+        uint64_t indices = 0;
+        for(int i = 0; i < 6; i++)
+            indices |= (uint64_t)in[2 + i] << (8 * i);
+        for(int y = 0; y < h; y++)
+        {
+            for(int x = 0; x < w; x++)
+                rgba[(size_t)y * stride + x * 4 + channel] = (unsigned char)palette[(indices >> (3 * (y * 4 + x))) & 7];
+        }
+    }
+
+    size_t block_bytes(BlockFormat format)
+    {
+        return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+    }
+}
+
+BlockFormat choose_block_format(const unsigned char* pixels, int width, int height, int channels, bool normal_map)
+{
+    if(normal_map)
+        return BLOCK_BC5;
+    if(channels == 1)
+        return BLOCK_BC4;
+
+    bool grey = channels >= 3, opaque = true;
+    size_t n = (size_t)width * height;
+    for(size_t i = 0; i < n && (grey || opaque); i++)
+    {
+        const unsigned char* p = pixels + i * channels;
+        if(grey && (p[0] != p[1] || p[1] != p[2]))
+            grey = false;
+        if(opaque && (channels == 2 || channels == 4) && p[channels - 1] != 255)
+            opaque = false;
+    }
+    if(channels == 2)
+        return opaque ? BLOCK_BC4 : BLOCK_BC3;
+    if(grey && opaque)
+        return BLOCK_BC4;
+    return opaque ? BLOCK_BC1 : BLOCK_BC3;
+}
+
+size_t block_compressed_size(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+}
+
+GLenum block_gl_format(BlockFormat format, bool srgb)
+{
+    switch(format)
+    {
+    case BLOCK_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+    default:        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+const char* block_format_name(BlockFormat format)
+{
+    static const char* NAMES[] = { "BC1", "BC3", "BC4", "BC5" };
+    return NAMES[format];
+}
+
+void compress_blocks(BlockFormat format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out)
+{
+    int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    size_t bytes = block_bytes(format);
+    parallel_for(0, blocks_y, [&](size_t row_begin, size_t row_end)
+    {
+        Block block;
+        for(size_t by = row_begin; by < row_end; by++)
+        {
+            unsigned char* dst = out + by * blocks_x * bytes;
+            for(int bx = 0; bx < blocks_x; bx++, dst += bytes)
+            {
+                load_block(pixels, width, height, channels, bx, (int)by, block);
+                switch(format)
+                {
+                case BLOCK_BC1: encode_color_block(block, dst); break;
+                case BLOCK_BC3: encode_channel_block(block, 3, dst); encode_color_block(block, dst + 8); break;
+                case BLOCK_BC4: encode_channel_block(block, 0, dst); break;
+                case BLOCK_BC5: encode_channel_block(block, 0, dst); encode_channel_block(block, 1, dst + 8); break;
+                }
+            }
+        }
+    }, 8);
+}
+
+void decompress_blocks(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+    int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    size_t bytes = block_bytes(format);
+    int stride = width * 4;
+    for(int by = 0; by < blocks_y; by++)
+    {
+        for(int bx = 0; bx < blocks_x; bx++, blocks += bytes)
+        {
+            unsigned char* dst = rgba + (size_t)by * 4 * stride + bx * 16;
+            int w = std::min(4, width - bx * 4), h = std::min(4, height - by * 4);
+            switch(format)
+            {
+            case BLOCK_BC1:
+                decode_color_block(blocks, dst, stride, w, h);
+                break;
+            case BLOCK_BC3:
+                decode_color_block(blocks + 8, dst, stride, w, h);
+                decode_channel_block(blocks, dst, stride, w, h, 3);
+                break;
+            case BLOCK_BC4:
+                clear_block(dst, stride, w, h);
+                decode_channel_block(blocks, dst, stride, w, h, 0);
+                for(int y = 0; y < h; y++)
+                {
+                    for(int x = 0; x < w; x++)
+                    {
+                        unsigned char* p = dst + (size_t)y * stride + x * 4;
+                        p[1] = p[2] = p[0]; // as sampled with the red swizzle
+                    }
+                }
+                break;
+            case BLOCK_BC5:
+                clear_block(dst, stride, w, h);
+                decode_channel_block(blocks, dst, stride, w, h, 0);
+                decode_channel_block(blocks + 8, dst, stride, w, h, 1);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#include "TextureLoader.hpp"
+#include "GLState.hpp"
+#include "stb_image.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// FNV-1a style mix over 8 byte words, the tail byte by byte
+uint64_t hash_pixels(const unsigned char* pixels, int width, int height, int channels)
+{
+    const uint64_t PRIME = 1099511628211ull;
+    uint64_t h = 14695981039346656037ull;
+    h = (h ^ (uint64_t)width) * PRIME;
+    h = (h ^ (uint64_t)height) * PRIME;
+    h = (h ^ (uint64_t)channels) * PRIME;
+
+    size_t size = (size_t)width * height * channels;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, pixels + i, 8);
+        h = (h ^ word) * PRIME;
+        h ^= h >> 29;
+    }
+    for(; i < size; i++)
+        h = (h ^ pixels[i]) * PRIME;
+    return h;
+}
+
+TextureLoader::TextureLoader(unsigned int n_workers, size_t queue_capacity)
+    : uploaded_last_pump(0), decoded(queue_capacity), in_flight(0), stopping(false), next_pbo(0), workers(n_workers)
+{
+    glGenBuffers(2, pbos);
+}
+
+TextureLoader::~TextureLoader()
+{
+    stopping = true; // workers blocked on a full queue give up instead of waiting for a pump that never comes
+}
+
+GLuint TextureLoader::load(const std::string& path, const TextureOptions& options)
+{
+    // the texture starts out as a 1x1 placeholder so it can be bound immediately
+    static const unsigned char PLACEHOLDER[4] = { 128, 128, 128, 255 };
+    GLuint texture;
+    glGenTextures(1, &texture);
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    in_flight++;
+    workers.submit([this, texture, path, options]()
+    {
+        if(stopping)
+            return;
+        DecodedImage image;
+        image.texture = texture;
+        image.path = path;
+        image.options = options;
+        image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+        if(image.pixels)
+        {
+            image.content_hash = hash_pixels(image.pixels, image.width, image.height, image.channels);
+            if(options.mipmaps) // filtered here rather than by glGenerateMipmap on the GL thread
+            {
+                MipOptions mip_options;
+                mip_options.srgb = options.srgb; // data maps (specular, masks) are filtered as stored
+                image.mips = generate_mips(image.pixels, image.width, image.height, image.channels, mip_options);
+            }
+        }
+        while(!decoded.push(image))
+        {
+            if(stopping)
+            {
+                stbi_image_free(image.pixels);
+                return;
+            }
+            std::this_thread::yield();
+        }
+    });
+    return texture;
+}
+
+unsigned int TextureLoader::pump(double budget_ms)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+    uploaded_last_pump = 0;
+
+    DecodedImage image;
+    while(decoded.pop(image))
+    {
+        upload(image);
+        in_flight--;
+        uploaded_last_pump++;
+        if(std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budget_ms)
+            break;
+    }
+    return uploaded_last_pump;
+}
+
+void TextureLoader::finish()
+{
+    while(pending() > 0)
+    {
+        if(!pump(1e9))
+            std::this_thread::yield();
+    }
+}
+
+void TextureLoader::upload(DecodedImage& image)
+{
+    if(on_decoded && !on_decoded(image))
+    {
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+        return;
+    }
+    if(!image.pixels)
+    {
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        return; // keeps the placeholder
+    }
+
+    GLenum format = GL_RGB;
+    if(image.channels == 1)
+        format = GL_RED;
+    else if(image.channels == 2) // grey + alpha
+        format = GL_RG;
+    else if(image.channels == 3)
+        format = GL_RGB;
+    else if(image.channels == 4)
+        format = GL_RGBA;
+    GLint internal_format = format;
+    if(image.options.srgb && image.channels == 3)
+        internal_format = GL_SRGB8;
+    else if(image.options.srgb && image.channels == 4)
+        internal_format = GL_SRGB8_ALPHA8;
+
+    // every level back to back: level 0 from stbi, the rest generated on the worker
+    std::vector<const unsigned char*> level_pixels = { image.pixels };
+    std::vector<size_t> level_offsets = { 0 };
+    std::vector<int> level_widths = { image.width }, level_heights = { image.height };
+    size_t size = (size_t)image.width * image.height * image.channels;
+    for(const MipLevel& mip : image.mips)
+    {
+        level_pixels.push_back(mip.pixels.data());
+        level_offsets.push_back(size);
+        level_widths.push_back(mip.width);
+        level_heights.push_back(mip.height);
+        size += mip.pixels.size();
+    }
+    level_offsets.push_back(size);
+
+    // stage through alternating PBOs, orphaned each time so the copy never waits on an in-flight upload
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[next_pbo]);
+    next_pbo ^= 1;
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    unsigned char* staging = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if(staging)
+    {
+        for(size_t i = 0; i < level_pixels.size(); i++)
+            std::memcpy(staging + level_offsets[i], level_pixels[i], level_offsets[i + 1] - level_offsets[i]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else // mapping failed, upload straight from client memory
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, image.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of RGB images aren't 4 byte aligned
+    for(size_t i = 0; i < level_pixels.size(); i++)
+    {
+        const void* source = staging ? (const void*)level_offsets[i] : (const void*)level_pixels[i];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, internal_format, level_widths[i], level_heights[i], 0, format, GL_UNSIGNED_BYTE, source);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)level_pixels.size() - 1);
+    if(image.channels == 2)
+    {
+        // sampled as (grey, grey, grey, alpha) like the stbi source image
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    if(image.options.mipmaps)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    image.mips.clear();
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+void TextureLoader::destroy()
+{
+    stopping = true;
+    workers.wait_idle(); // remaining jobs bail out early, nothing can be pushed after this
+    DecodedImage image;
+    while(decoded.pop(image))
+        stbi_image_free(image.pixels);
+    glDeleteBuffers(2, pbos);
+}
@@ -0,0 +1,335 @@
+#include "TextureManager.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+std::string normalize_texture_path(const std::string& path)
+{
+    std::string p = path;
+    std::replace(p.begin(), p.end(), '\\', '/');
+    #ifdef _WIN32
+    std::transform(p.begin(), p.end(), p.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    #endif
+
+    // keep a drive letter / leading slash as the root, resolve "." and ".." against the rest
+    std::string root;
+    size_t start = 0;
+    if(p.size() >= 2 && p[1] == ':')
+    {
+        root = p.substr(0, 2);
+        start = 2;
+    }
+    if(start < p.size() && p[start] == '/')
+    {
+        root += '/';
+        start++;
+    }
+
+    std::vector<std::string> parts;
+    while(start <= p.size())
+    {
+        size_t end = p.find('/', start);
+        if(end == std::string::npos)
+            end = p.size();
+        std::string part = p.substr(start, end - start);
+        if(part == "..")
+        {
+            if(!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if(root.empty())
+                parts.push_back(part);
+        }
+        else if(!part.empty() && part != ".")
+            parts.push_back(part);
+        start = end + 1;
+    }
+
+    std::string result = root;
+    for(size_t i = 0; i < parts.size(); i++)
+    {
+        if(i > 0)
+            result += '/';
+        result += parts[i];
+    }
+    return result;
+}
+
+static std::string options_suffix(const TextureOptions& options)
+{
+    return "|" + std::to_string(options.wrap) + (options.mipmaps ? "m" : "") + (options.srgb ? "s" : "");
+}
+
+// the same pixels sampled with different options can't share a texture
+static uint64_t make_content_key(uint64_t content_hash, const TextureOptions& options)
+{
+    uint64_t options_hash = std::hash<std::string>()(options_suffix(options));
+    return content_hash ^ (options_hash * 0x9E3779B97F4A7C15ull);
+}
+
+TextureManager::TextureManager(TextureLoader& loader, size_t vram_budget_bytes)
+    : evictions(0), deduplicated(0), loader(loader), pack(nullptr), vram_budget(vram_budget_bytes), resident(0)
+{
+    loader.on_decoded = [this](const DecodedImage& image) { return on_decoded(image); };
+}
+
+int TextureManager::new_entry()
+{
+    if(!free_entries.empty())
+    {
+        int id = free_entries.back();
+        free_entries.pop_back();
+        return id;
+    }
+    entries.emplace_back();
+    return (int)entries.size() - 1;
+}
+
+int TextureManager::new_gpu_texture()
+{
+    if(!free_gpu.empty())
+    {
+        int id = free_gpu.back();
+        free_gpu.pop_back();
+        return id;
+    }
+    gpu_textures.emplace_back();
+    return (int)gpu_textures.size() - 1;
+}
+
+TextureHandle TextureManager::acquire(const std::string& path, const TextureOptions& options)
+{
+    std::string key = normalize_texture_path(path) + options_suffix(options);
+    auto found = by_key.find(key);
+    if(found != by_key.end())
+    {
+        TextureHandle handle;
+        handle.id = found->second;
+        retain(handle);
+        return handle;
+    }
+
+    int gpu = -1;
+    const TexturePackEntry* cooked = pack ? pack->find(path) : nullptr;
+    if(cooked)
+        gpu = acquire_from_pack(*cooked, options);
+    else
+    {
+        gpu = new_gpu_texture();
+        GpuTexture& texture = gpu_textures[gpu];
+        texture.name = loader.load(path, options);
+        texture.content_key = 0;
+        texture.bytes = 4; // 1x1 RGBA placeholder until the real image lands
+        texture.users = 1;
+        texture.ready = false;
+        resident += texture.bytes;
+        pending_by_name[texture.name] = gpu;
+    }
+
+    int id = new_entry();
+    Entry& entry = entries[id];
+    entry.key = key;
+    entry.gpu = gpu;
+    entry.refs = 1;
+    by_key[key] = id;
+
+    trim();
+    TextureHandle handle;
+    handle.id = id;
+    return handle;
+}
+
+// the cooker already stores identical images once, so the offset of level 0 identifies the content
+int TextureManager::acquire_from_pack(const TexturePackEntry& cooked, const TextureOptions& options)
+{
+    uint64_t content_key = make_content_key(cooked.levels[0].offset | (1ull << 63), options);
+    auto existing = by_content.find(content_key);
+    if(existing != by_content.end())
+    {
+        gpu_textures[existing->second].users++;
+        deduplicated++;
+        return existing->second;
+    }
+
+    int gpu = new_gpu_texture();
+    GpuTexture& texture = gpu_textures[gpu];
+    texture.name = pack->upload(cooked, options);
+    texture.content_key = content_key;
+    texture.bytes = options.mipmaps ? pack->entry_bytes(cooked) : cooked.levels[0].size;
+    texture.users = 1;
+    texture.ready = true;
+    resident += texture.bytes;
+    by_content[content_key] = gpu;
+    return gpu;
+}
+
+void TextureManager::retain(TextureHandle handle)
+{
+    Entry& entry = entries[handle.id];
+    if(entry.refs++ == 0)
+        unreferenced.erase(entry.lru);
+}
+
+void TextureManager::release(TextureHandle handle)
+{
+    Entry& entry = entries[handle.id];
+    if(entry.refs <= 0)
+    {
+        std::cout << "ERROR::TEXTURE_MANAGER::RELEASE_UNREFERENCED: " << entry.key << std::endl;
+        return;
+    }
+    if(--entry.refs == 0)
+    {
+        entry.lru = unreferenced.insert(unreferenced.end(), handle.id);
+        trim();
+    }
+}
+
+GLuint TextureManager::texture(TextureHandle handle) const
+{
+    return gpu_textures[entries[handle.id].gpu].name;
+}
+
+bool TextureManager::on_decoded(const DecodedImage& image)
+{
+    auto pending = pending_by_name.find(image.texture);
+    if(pending == pending_by_name.end())
+        return true; // loaded through the loader directly, not managed
+    int gpu = pending->second;
+    pending_by_name.erase(pending);
+    GpuTexture& texture = gpu_textures[gpu];
+    texture.ready = true;
+    if(!image.pixels)
+        return true; // keeps the placeholder
+
+    // same pixels and options as a texture already resident: point this entry at it and drop the placeholder.
+    // The hash only finds the candidate, the bytes decide.
+    uint64_t content_key = make_content_key(image.content_hash, image.options);
+    auto existing = by_content.find(content_key);
+    if(existing != by_content.end() && !same_pixels(gpu_textures[existing->second], image))
+    {
+        std::cout << "TEXTURE_MANAGER::content hash collision, not sharing: " << image.path << std::endl;
+        content_key = 0; // stays a texture of its own, the key keeps pointing at the first one
+        existing = by_content.end();
+    }
+    if(existing != by_content.end())
+    {
+        for(Entry& entry : entries)
+        {
+            if(entry.gpu == gpu)
+            {
+                entry.gpu = existing->second;
+                gpu_textures[existing->second].users++;
+            }
+        }
+        resident -= texture.bytes;
+        gl_state().forget_texture(texture.name);
+        glDeleteTextures(1, &texture.name);
+        texture = GpuTexture();
+        free_gpu.push_back(gpu);
+        deduplicated++;
+        return false;
+    }
+
+    resident -= texture.bytes;
+    texture.bytes = (size_t)image.width * image.height * image.channels;
+    if(image.options.mipmaps)
+        texture.bytes += texture.bytes / 3;
+    resident += texture.bytes;
+    texture.width = image.width;
+    texture.height = image.height;
+    texture.channels = image.channels;
+    texture.content_key = content_key;
+    if(content_key)
+        by_content[content_key] = gpu;
+    trim();
+    return true;
+}
+
+// reads the resident level 0 back, only ever on a hash match. A readback that doesn't reproduce the source bytes
+// exactly costs the sharing, never a wrong image.
+bool TextureManager::same_pixels(const GpuTexture& texture, const DecodedImage& image) const
+{
+    if(texture.width != image.width || texture.height != image.height || texture.channels != image.channels)
+        return false;
+    static const GLenum FORMATS[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    std::vector<unsigned char> pixels((size_t)image.width * image.height * image.channels);
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture.name);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, FORMATS[image.channels - 1], GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return std::memcmp(pixels.data(), image.pixels, pixels.size()) == 0;
+}
+
+void TextureManager::drop_gpu_user(int gpu)
+{
+    GpuTexture& texture = gpu_textures[gpu];
+    if(--texture.users > 0)
+        return;
+    resident -= texture.bytes;
+    gl_state().forget_texture(texture.name);
+    glDeleteTextures(1, &texture.name);
+    if(texture.content_key)
+        by_content.erase(texture.content_key);
+    texture = GpuTexture();
+    free_gpu.push_back(gpu);
+}
+
+void TextureManager::evict(int id)
+{
+    Entry& entry = entries[id];
+    unreferenced.erase(entry.lru);
+    by_key.erase(entry.key);
+    drop_gpu_user(entry.gpu);
+    entry = Entry();
+    free_entries.push_back(id);
+    evictions++;
+}
+
+void TextureManager::trim()
+{
+    auto it = unreferenced.begin();
+    while(resident > vram_budget && it != unreferenced.end())
+    {
+        int id = *it++;
+        if(gpu_textures[entries[id].gpu].ready) // the loader still owns the name of a pending texture
+            evict(id);
+    }
+}
+
+void TextureManager::set_budget(size_t bytes)
+{
+    vram_budget = bytes;
+    trim();
+}
+
+void TextureManager::print_report() const
+{
+    std::cout << "TEXTURES::resident " << (resident >> 10) << " KB / " << (vram_budget >> 10) << " KB, "
+              << texture_count() << " textures, " << (entries.size() - free_entries.size()) << " entries ("
+              << unreferenced.size() << " unreferenced), " << deduplicated << " deduplicated, "
+              << evictions << " evicted" << std::endl;
+}
+
+void TextureManager::destroy()
+{
+    for(GpuTexture& texture : gpu_textures)
+    {
+        if(texture.name)
+        {
+            gl_state().forget_texture(texture.name);
+            glDeleteTextures(1, &texture.name);
+        }
+    }
+    entries.clear();
+    free_entries.clear();
+    gpu_textures.clear();
+    free_gpu.clear();
+    by_key.clear();
+    by_content.clear();
+    pending_by_name.clear();
+    unreferenced.clear();
+    resident = 0;
+    loader.on_decoded = nullptr;
+}
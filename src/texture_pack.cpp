@@ -0,0 +1,224 @@
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h> // before glad so APIENTRY is only defined once
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#include "TexturePack.hpp"
+#include "TextureManager.hpp"
+#include "GLState.hpp"
+#include "TextureCompression.hpp"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    // bytes a level of entry must hold, 0 for a format the pack can't contain
+    size_t expected_level_size(const TexturePackEntry& entry, const TexturePackLevel& level)
+    {
+        size_t blocks = (size_t)((level.width + 3) / 4) * ((level.height + 3) / 4);
+        if(entry.flags & TEXTURE_PACK_COMPRESSED)
+        {
+            switch(entry.internal_format)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RED_RGTC1:
+                return blocks * 8;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_RG_RGTC2:
+                return blocks * 16;
+            default:
+                return 0;
+            }
+        }
+        if(entry.type != GL_UNSIGNED_BYTE)
+            return 0;
+        size_t channels = entry.format == GL_RED ? 1 : entry.format == GL_RG ? 2 : entry.format == GL_RGB ? 3 : entry.format == GL_RGBA ? 4 : 0;
+        return (size_t)level.width * level.height * channels; // rows are tightly packed, upload() unpacks with alignment 1
+    }
+
+    // every level inside the file and as large as its size and format say
+    bool valid_entry(const TexturePackEntry& entry, size_t file_size)
+    {
+        if(!std::memchr(entry.name, 0, TEXTURE_PACK_NAME_SIZE))
+            return false;
+        if(entry.level_count == 0 || entry.level_count > (uint32_t)TEXTURE_PACK_MAX_LEVELS)
+            return false;
+        if(entry.levels[0].width != entry.width || entry.levels[0].height != entry.height)
+            return false;
+        for(uint32_t i = 0; i < entry.level_count; i++)
+        {
+            const TexturePackLevel& level = entry.levels[i];
+            if(level.width == 0 || level.height == 0 || level.size != expected_level_size(entry, level))
+                return false;
+            if(level.offset > file_size || level.size > file_size - level.offset)
+                return false;
+        }
+        return true;
+    }
+
+    // normalized and absolute, so a relative pack path and an absolute texture path can be compared
+    std::string absolute_texture_path(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return normalize_texture_path(error ? path : absolute.generic_string());
+    }
+}
+
+TexturePack::TexturePack()
+    : data(nullptr), size(0), header(nullptr), entries(nullptr)
+{
+    #ifdef _WIN32
+    file_handle = nullptr;
+    mapping_handle = nullptr;
+    #endif
+}
+
+bool TexturePack::open(const std::string& path)
+{
+    close();
+
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    file_handle = file;
+    mapping_handle = mapping;
+    size = (size_t)file_size.QuadPart;
+    #else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    fstat(fd, &st);
+    size = (size_t)st.st_size;
+    void* mapped = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd); // the mapping keeps the file alive
+    data = mapped == MAP_FAILED ? nullptr : (const unsigned char*)mapped;
+    #endif
+    if(!data)
+    {
+        close();
+        return false;
+    }
+
+    header = (const TexturePackHeader*)data;
+    if(size < sizeof(TexturePackHeader) || header->magic != TEXTURE_PACK_MAGIC || header->version != TEXTURE_PACK_VERSION
+       || size < sizeof(TexturePackHeader) + (size_t)header->texture_count * sizeof(TexturePackEntry))
+    {
+        std::cout << "ERROR::TEXTURE_PACK::INVALID: " << path << std::endl;
+        close();
+        return false;
+    }
+    entries = (const TexturePackEntry*)(data + sizeof(TexturePackHeader));
+    for(uint32_t i = 0; i < header->texture_count; i++)
+    {
+        if(!valid_entry(entries[i], size))
+        {
+            std::cout << "ERROR::TEXTURE_PACK::INVALID_ENTRY " << i << ": " << path << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    // entry names are relative to the directory the pack was cooked from, which is where it sits
+    std::string root = absolute_texture_path(path);
+    root = root.substr(0, root.rfind('/') + 1);
+    for(uint32_t i = 0; i < header->texture_count; i++)
+        by_name[normalize_texture_path(root + entries[i].name)] = i;
+    return true;
+}
+
+const TexturePackEntry* TexturePack::find(const std::string& path) const
+{
+    if(!data)
+        return nullptr;
+    auto found = by_name.find(absolute_texture_path(path));
+    return found != by_name.end() ? &entries[found->second] : nullptr;
+}
+
+GLuint TexturePack::upload(const TexturePackEntry& entry, const TextureOptions& options) const
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture);
+
+    GLint internal_format = entry.internal_format;
+    if(options.srgb && internal_format == GL_RGB8)
+        internal_format = GL_SRGB8;
+    else if(options.srgb && internal_format == GL_RGBA8)
+        internal_format = GL_SRGB8_ALPHA8;
+    else if(options.srgb && internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        internal_format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    else if(options.srgb && internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+
+    uint32_t levels = options.mipmaps ? entry.level_count : 1;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(uint32_t i = 0; i < levels; i++)
+    {
+        const TexturePackLevel& level = entry.levels[i];
+        if(entry.flags & TEXTURE_PACK_COMPRESSED)
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internal_format, level.width, level.height, 0, level.size, data + level.offset);
+        else
+            glTexImage2D(GL_TEXTURE_2D, i, internal_format, level.width, level.height, 0, entry.format, entry.type, data + level.offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    if(entry.flags & TEXTURE_PACK_SWIZZLE_RED)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+size_t TexturePack::entry_bytes(const TexturePackEntry& entry) const
+{
+    size_t bytes = 0;
+    for(uint32_t i = 0; i < entry.level_count; i++)
+        bytes += entry.levels[i].size;
+    return bytes;
+}
+
+void TexturePack::close()
+{
+    #ifdef _WIN32
+    if(data)
+        UnmapViewOfFile(data);
+    if(mapping_handle)
+        CloseHandle(mapping_handle);
+    if(file_handle)
+        CloseHandle(file_handle);
+    file_handle = nullptr;
+    mapping_handle = nullptr;
+    #else
+    if(data)
+        munmap((void*)data, size);
+    #endif
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+    entries = nullptr;
+    by_name.clear();
+}
@@ -0,0 +1,199 @@
+#include "TextureStreamer.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+float projected_pixels(float radius, float distance, float fovY, float screenHeight)
+{
+    if(distance <= radius)
+        return screenHeight * 4.0f; // camera inside the bounds, want everything
+    return radius * screenHeight / (distance * std::tan(fovY * 0.5f));
+}
+
+int mip_for_screen_size(int texture_size, float screen_pixels, int level_count)
+{
+    if(screen_pixels <= 0.0f)
+        return level_count - 1;
+    float texels_per_pixel = texture_size / screen_pixels;
+    if(texels_per_pixel <= 1.0f)
+        return 0;
+    return std::min((int)std::floor(std::log2(texels_per_pixel)), level_count - 1);
+}
+
+TextureStreamer::TextureStreamer(const TexturePack& pack, size_t budget_bytes, unsigned int max_in_flight)
+    : resident_bytes(0), evictions(0), uploads(0), pack(pack), budget(budget_bytes), max_in_flight(max_in_flight),
+      frame(1), loaded(64), in_flight(0), stopping(false), io(1) {}
+
+StreamHandle TextureStreamer::add(const std::string& path)
+{
+    StreamHandle handle;
+    const TexturePackEntry* entry = pack.find(path);
+    if(!entry)
+    {
+        std::cout << "ERROR::TEXTURE_STREAMER::NOT_IN_PACK: " << path << std::endl;
+        return handle;
+    }
+
+    StreamedTexture texture;
+    texture.entry = entry;
+    texture.pinned_top = (int)entry->level_count - 1;
+    while(texture.pinned_top > 0 && std::max(entry->levels[texture.pinned_top - 1].width, entry->levels[texture.pinned_top - 1].height) <= MIN_RESIDENT_SIZE)
+        texture.pinned_top--;
+    texture.resident_top = texture.pinned_top;
+    texture.wanted_top = texture.pinned_top;
+    texture.loading = false;
+    texture.last_used = 0;
+
+    glGenTextures(1, &texture.name);
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture.name);
+    for(int level = texture.pinned_top; level < (int)entry->level_count; level++)
+        upload_level(texture, level);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.resident_top);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry->level_count - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if(entry->flags & TEXTURE_PACK_SWIZZLE_RED)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+
+    textures.push_back(texture);
+    handle.id = (int)textures.size() - 1;
+    return handle;
+}
+
+void TextureStreamer::request(StreamHandle handle, float screen_pixels)
+{
+    StreamedTexture& texture = textures[handle.id];
+    int size = (int)std::max(texture.entry->width, texture.entry->height);
+    int level = mip_for_screen_size(size, screen_pixels, (int)texture.entry->level_count);
+    texture.wanted_top = std::min(texture.wanted_top, level);
+    texture.last_used = frame;
+}
+
+// expects the texture bound to unit 0
+void TextureStreamer::upload_level(StreamedTexture& texture, int level)
+{
+    const TexturePackEntry& entry = *texture.entry;
+    const TexturePackLevel& info = entry.levels[level];
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(entry.flags & TEXTURE_PACK_COMPRESSED)
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internal_format, info.width, info.height, 0, info.size, pack.level_data(entry, level));
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, entry.internal_format, info.width, info.height, 0, entry.format, entry.type, pack.level_data(entry, level));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    resident_bytes += info.size;
+}
+
+void TextureStreamer::release_top_level(StreamedTexture& texture)
+{
+    int level = texture.resident_top;
+    gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // respecifying the level as 0x0 hands its storage back; it is outside [base, max] so the texture stays complete
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    texture.resident_top++;
+    resident_bytes -= texture.entry->levels[level].size;
+    evictions++;
+}
+
+// drops the top level of the least recently used texture that has something to give back. Textures used in the
+// current frame only lose levels finer than they asked for.
+bool TextureStreamer::evict_one(uint64_t current_frame)
+{
+    StreamedTexture* victim = nullptr;
+    for(StreamedTexture& texture : textures)
+    {
+        if(texture.loading || texture.resident_top >= texture.pinned_top)
+            continue;
+        if(texture.last_used == current_frame && texture.resident_top >= texture.wanted_top)
+            continue;
+        if(!victim || texture.last_used < victim->last_used)
+            victim = &texture;
+    }
+    if(!victim)
+        return false;
+    release_top_level(*victim);
+    return true;
+}
+
+void TextureStreamer::update()
+{
+    // finished reads: the pages are in memory now, upload straight from the mapping
+    LoadedLevel done;
+    while(loaded.pop(done))
+    {
+        StreamedTexture& texture = textures[done.texture];
+        texture.loading = false;
+        in_flight--;
+        if(done.level != texture.resident_top - 1)
+            continue;
+        gl_state().bind_texture_unit(0, GL_TEXTURE_2D, texture.name);
+        upload_level(texture, done.level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, done.level);
+        texture.resident_top = done.level;
+        uploads++;
+    }
+
+    // new reads, one level per texture at a time, only if the budget can make room for it
+    for(size_t i = 0; i < textures.size() && in_flight < max_in_flight; i++)
+    {
+        StreamedTexture& texture = textures[i];
+        if(texture.loading || texture.wanted_top >= texture.resident_top)
+            continue;
+        int level = texture.resident_top - 1;
+        size_t size = texture.entry->levels[level].size;
+        while(resident_bytes + size > budget && evict_one(frame)) {}
+        if(resident_bytes + size > budget)
+            continue;
+
+        texture.loading = true;
+        in_flight++;
+        const unsigned char* data = pack.level_data(*texture.entry, level);
+        int id = (int)i;
+        io.submit([this, id, level, data, size]()
+        {
+            // touching one byte per page is enough to fault the level in off the GL thread
+            volatile unsigned char sink = 0;
+            for(size_t offset = 0; offset < size && !stopping; offset += 4096)
+                sink ^= data[offset];
+            (void)sink;
+            LoadedLevel result = { id, level };
+            while(!loaded.push(result) && !stopping)
+                std::this_thread::yield();
+        });
+    }
+
+    // the budget may have shrunk, or finished uploads pushed it over
+    while(resident_bytes > budget && evict_one(frame)) {}
+
+    for(StreamedTexture& texture : textures)
+        texture.wanted_top = texture.pinned_top;
+    frame++;
+}
+
+void TextureStreamer::print_report() const
+{
+    std::cout << "STREAMING::resident " << (resident_bytes >> 10) << " KB / " << (budget >> 10) << " KB, "
+              << pending() << " pending, " << uploads << " levels streamed in, " << evictions << " evicted" << std::endl;
+}
+
+void TextureStreamer::destroy()
+{
+    stopping = true;
+    io.wait_idle();
+    LoadedLevel done;
+    while(loaded.pop(done)) {}
+    for(StreamedTexture& texture : textures)
+    {
+        gl_state().forget_texture(texture.name);
+        glDeleteTextures(1, &texture.name);
+    }
+    textures.clear();
+    resident_bytes = 0;
+    in_flight = 0;
+}
@@ -0,0 +1,65 @@
+#include "ThreadPool.hpp"
+#include "Parallel.hpp"
+
+ThreadPool::ThreadPool(unsigned int n_threads)
+    : running(0), stopping(false)
+{
+    if(n_threads == 0)
+        n_threads = worker_count();
+    workers.reserve(n_threads);
+    for(unsigned int i = 0; i < n_threads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    job_available.notify_all();
+    for(std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_available.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return jobs.empty() && running == 0; });
+}
+
+void ThreadPool::worker_loop()
+{
+    for(;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(stopping)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            if(jobs.empty() && running == 0)
+                idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,244 @@
+// texture_cooker: bakes every image under a directory into one texture pack (see TexturePackFormat.hpp).
+//   texture_cooker [--uncompressed] [--filter box|kaiser|lanczos] [--alpha-cutoff 0.5]
+//                  [source dir = ../res] [output = <source dir>/textures.pack]
+// Entry names are relative to the source dir and the renderer resolves them against the pack's own directory,
+// so the pack belongs at the root of the directory it was cooked from.
+// Images are decoded once here, their mip chains generated (gamma correct, see MipGenerator.hpp) and block compressed (BC4 for grey maps, BC5 for
+// files named *normal*, BC1 / BC3 for color) and laid out the way gl(Compressed)TexImage2D takes them,
+// so the renderer only has to map the file and upload.
+#include <glad/glad.h>
+#include "TexturePackFormat.hpp"
+#include "TextureCompression.hpp"
+#include "MipGenerator.hpp"
+#include "stb_image.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+struct CookedImage
+{
+    TexturePackEntry entry;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+struct CookSettings
+{
+    bool compress = true;
+    MipOptions mips;
+};
+
+static void compress_levels(CookedImage& image, bool normal_map)
+{
+    TexturePackEntry& entry = image.entry;
+    BlockFormat format = choose_block_format(image.levels[0].data(), entry.width, entry.height, entry.channels, normal_map);
+    for(uint32_t i = 0; i < entry.level_count; i++)
+    {
+        TexturePackLevel& level = entry.levels[i];
+        std::vector<unsigned char> blocks(block_compressed_size(format, level.width, level.height));
+        compress_blocks(format, image.levels[i].data(), level.width, level.height, entry.channels, blocks.data());
+        image.levels[i] = std::move(blocks);
+        level.size = (uint32_t)image.levels[i].size();
+    }
+    entry.internal_format = block_gl_format(format, false);
+    entry.format = 0;
+    entry.type = 0;
+    entry.flags |= TEXTURE_PACK_COMPRESSED;
+    if(format == BLOCK_BC4)
+        entry.flags |= TEXTURE_PACK_SWIZZLE_RED;
+}
+
+static bool cook_image(const fs::path& file, const std::string& name, const CookSettings& settings, CookedImage& out)
+{
+    int w, h, channels;
+    unsigned char* pixels = stbi_load(file.string().c_str(), &w, &h, &channels, 0);
+    if(!pixels)
+    {
+        std::cout << "ERROR::COOKER::DECODE_FAILED: " << file.string() << " (" << stbi_failure_reason() << ")" << std::endl;
+        return false;
+    }
+    bool grey = channels <= 2; // single channel masks and grey maps are data, not colors
+    if(channels == 2) // no two channel GPU format we want to sample as color, expand to RGBA
+    {
+        std::vector<unsigned char> rgba((size_t)w * h * 4);
+        for(size_t i = 0; i < (size_t)w * h; i++)
+        {
+            rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = pixels[i * 2];
+            rgba[i * 4 + 3] = pixels[i * 2 + 1];
+        }
+        stbi_image_free(pixels);
+        pixels = nullptr;
+        out.levels.push_back(std::move(rgba));
+        channels = 4;
+    }
+    else
+    {
+        out.levels.emplace_back(pixels, pixels + (size_t)w * h * channels);
+        stbi_image_free(pixels);
+    }
+
+    TexturePackEntry& entry = out.entry;
+    std::memset(&entry, 0, sizeof(entry));
+    std::strncpy(entry.name, name.c_str(), TEXTURE_PACK_NAME_SIZE - 1);
+    entry.width = w;
+    entry.height = h;
+    entry.channels = channels;
+    entry.type = GL_UNSIGNED_BYTE;
+    entry.format = channels == 1 ? GL_RED : channels == 3 ? GL_RGB : GL_RGBA;
+    entry.internal_format = channels == 1 ? GL_R8 : channels == 3 ? GL_RGB8 : GL_RGBA8;
+
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    bool normal_map = lower.find("normal") != std::string::npos;
+    bool specular_map = lower.find("specular") != std::string::npos;
+
+    MipOptions mip_options = settings.mips;
+    mip_options.srgb = !normal_map && !specular_map && !grey; // normals are vectors and specular / grey maps intensities, not colors
+    mip_options.max_levels = TEXTURE_PACK_MAX_LEVELS;
+    std::vector<MipLevel> mips = generate_mips(out.levels[0].data(), w, h, channels, mip_options);
+    entry.levels[0].width = (uint16_t)w;
+    entry.levels[0].height = (uint16_t)h;
+    for(MipLevel& mip : mips)
+    {
+        TexturePackLevel& level = entry.levels[out.levels.size()];
+        level.width = (uint16_t)mip.width;
+        level.height = (uint16_t)mip.height;
+        out.levels.push_back(std::move(mip.pixels));
+    }
+    entry.level_count = (uint32_t)out.levels.size();
+    for(uint32_t i = 0; i < entry.level_count; i++)
+        entry.levels[i].size = (uint32_t)out.levels[i].size();
+    if(channels == 1)
+        entry.flags |= TEXTURE_PACK_SWIZZLE_RED;
+
+    if(settings.compress)
+        compress_levels(out, normal_map);
+    return true;
+}
+
+static bool is_image(const fs::path& file)
+{
+    std::string ext = file.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+int main(int argc, char** argv)
+{
+    CookSettings settings;
+    std::vector<std::string> positional;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--uncompressed")
+            settings.compress = false;
+        else if(arg == "--filter" && i + 1 < argc)
+        {
+            std::string filter = argv[++i];
+            settings.mips.filter = filter == "box" ? MIP_FILTER_BOX : filter == "lanczos" ? MIP_FILTER_LANCZOS : MIP_FILTER_KAISER;
+        }
+        else if(arg == "--alpha-cutoff" && i + 1 < argc)
+            settings.mips.alpha_cutoff = std::stof(argv[++i]);
+        else
+            positional.push_back(arg);
+    }
+    fs::path source = positional.size() > 0 ? fs::path(positional[0]) : fs::path("../res");
+    fs::path output = positional.size() > 1 ? fs::path(positional[1]) : source / "textures.pack";
+
+    std::vector<fs::path> files;
+    for(const fs::directory_entry& file : fs::recursive_directory_iterator(source))
+    {
+        if(file.is_regular_file() && is_image(file.path()))
+            files.push_back(file.path());
+    }
+    std::sort(files.begin(), files.end()); // stable pack layout between runs
+
+    std::vector<CookedImage> images;
+    for(const fs::path& file : files)
+    {
+        std::string name = fs::relative(file, source).generic_string();
+        if(name.size() >= (size_t)TEXTURE_PACK_NAME_SIZE)
+        {
+            std::cout << "ERROR::COOKER::NAME_TOO_LONG: " << name << std::endl;
+            continue;
+        }
+        CookedImage image;
+        if(cook_image(file, name, settings, image))
+            images.push_back(std::move(image));
+    }
+
+    // lay out the level data after the index; identical images point at the same data
+    size_t offset = sizeof(TexturePackHeader) + images.size() * sizeof(TexturePackEntry);
+    std::unordered_map<std::string, size_t> first_by_content; // level 0 bytes -> image that owns the data
+    std::vector<bool> owns_data(images.size(), true);
+    size_t shared = 0;
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        TexturePackEntry& entry = images[i].entry;
+        std::string content((const char*)images[i].levels[0].data(), images[i].levels[0].size());
+        content += std::to_string(entry.width) + "x" + std::to_string(entry.height) + "x" + std::to_string(entry.channels);
+        auto found = first_by_content.find(content);
+        if(found != first_by_content.end())
+        {
+            const TexturePackEntry& original = images[found->second].entry;
+            for(uint32_t l = 0; l < entry.level_count; l++)
+                entry.levels[l].offset = original.levels[l].offset;
+            owns_data[i] = false;
+            shared++;
+            continue;
+        }
+        first_by_content[content] = i;
+        for(uint32_t l = 0; l < entry.level_count; l++)
+        {
+            offset = (offset + TEXTURE_PACK_ALIGNMENT - 1) & ~(size_t)(TEXTURE_PACK_ALIGNMENT - 1);
+            entry.levels[l].offset = offset;
+            offset += entry.levels[l].size;
+        }
+    }
+
+    std::ofstream out(output, std::ios::binary);
+    if(!out)
+    {
+        std::cout << "ERROR::COOKER::CANNOT_WRITE: " << output.string() << std::endl;
+        return 1;
+    }
+    TexturePackHeader header = { TEXTURE_PACK_MAGIC, TEXTURE_PACK_VERSION, (uint32_t)images.size(), 0 };
+    out.write((const char*)&header, sizeof(header));
+    for(const CookedImage& image : images)
+        out.write((const char*)&image.entry, sizeof(TexturePackEntry));
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        if(!owns_data[i])
+            continue;
+        for(uint32_t l = 0; l < images[i].entry.level_count; l++)
+        {
+            size_t pad = images[i].entry.levels[l].offset - (size_t)out.tellp();
+            static const char ZEROS[TEXTURE_PACK_ALIGNMENT] = {};
+            out.write(ZEROS, pad);
+            out.write((const char*)images[i].levels[l].data(), images[i].levels[l].size());
+        }
+    }
+
+    for(const CookedImage& image : images)
+    {
+        size_t bytes = 0;
+        for(uint32_t l = 0; l < image.entry.level_count; l++)
+            bytes += image.entry.levels[l].size;
+        std::cout << "COOKER::" << image.entry.name << " " << image.entry.width << "x" << image.entry.height << ", "
+                  << image.entry.level_count << " levels, 0x" << std::hex << image.entry.internal_format << std::dec
+                  << ", " << (bytes >> 10) << " KB" << std::endl;
+    }
+    fs::path output_dir = output.parent_path().empty() ? fs::path(".") : output.parent_path();
+    std::error_code error;
+    if(!fs::equivalent(output_dir, source, error))
+        std::cout << "COOKER::warning: names are relative to " << source.string() << ", the renderer resolves them against the pack's directory" << std::endl;
+    std::cout << "COOKER::wrote " << images.size() << " textures (" << shared << " shared), "
+              << ((size_t)out.tellp() >> 10) << " KB to " << output.string() << std::endl;
+    return 0;
+}